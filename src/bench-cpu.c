@@ -0,0 +1,768 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "geometry.h"
+#include "ktx.h"
+#include "matrix.h"
+#include "scene.h"
+
+/* GL free correctness checks and micro benchmarks for the CPU side helpers.
+ * Every benchmark runs a batch of operations: a warm-up also sizes the
+ * repetitions, then each repetition is timed on its own and reported as
+ * ns per operation. Exits non-zero if any check fails.
+ */
+
+#define BENCH_MAX_REPETITIONS 31
+#define BENCH_MAX_BASELINE 128
+#define SCENE_CHECK_NODES 20000
+
+struct BenchBaseline {
+  char name[64];
+  int batch;
+  double median;
+};
+
+struct BenchConfig {
+  int repetitions;
+  uint64_t warmup_ns;
+  uint64_t repetition_ns;
+  const char *filter;
+
+  /* Medians of an earlier run, a benchmark fails if it got slower by more
+   * than tolerance (a fraction). Only comparable on the same machine.
+   */
+  struct BenchBaseline baseline[BENCH_MAX_BASELINE];
+  int baseline_count;
+  double tolerance;
+  FILE *save_baseline;
+};
+
+/* Runs one batch, returns the number of operations done */
+typedef long (*bench_batch_t)(void *state);
+
+static volatile GLfloat bench_sink;
+static int check_failures = 0;
+static int bench_regressions = 0;
+
+static uint64_t bench_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void *bench_alloc(size_t size) {
+  void *ptr = malloc(size);
+  if (!ptr) {
+    fprintf(stderr, "Error: out of memory for benchmark data\n");
+    exit(1);
+  }
+  return ptr;
+}
+
+/* Deterministic inputs in [-1, 1), the same on every run and machine */
+static GLfloat bench_random(uint32_t *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  return (GLfloat)(*seed >> 8) / (1 << 24) * 2.0f - 1.0f;
+}
+
+static void bench_random_fill(GLfloat *values, int count, uint32_t seed) {
+  for (int i = 0; i < count; i++) {
+    values[i] = bench_random(&seed);
+  }
+}
+
+static int bench_compare(const void *a, const void *b) {
+  double lhs = *(const double*)a;
+  double rhs = *(const double*)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static void bench_run(const struct BenchConfig *config, const char *name, int batch,
+                      bench_batch_t run, void *state) {
+  if (config->filter && !strstr(name, config->filter)) {
+    return;
+  }
+
+  /* Warm caches and branch predictors, and find how many batches fill a repetition */
+  long calls = 0;
+  uint64_t start = bench_now_ns(), elapsed;
+  do {
+    run(state);
+    calls++;
+    elapsed = bench_now_ns() - start;
+  } while (elapsed < config->warmup_ns);
+  long batches = (long)((double)calls * config->repetition_ns / elapsed);
+  if (batches < 1) {
+    batches = 1;
+  }
+
+  double samples[BENCH_MAX_REPETITIONS];
+  for (int r = 0; r < config->repetitions; r++) {
+    long ops = 0;
+    start = bench_now_ns();
+    for (long i = 0; i < batches; i++) {
+      ops += run(state);
+    }
+    samples[r] = (double)(bench_now_ns() - start) / ops;
+  }
+
+  double mean = 0.0, variance = 0.0;
+  for (int r = 0; r < config->repetitions; r++) {
+    mean += samples[r];
+  }
+  mean /= config->repetitions;
+  for (int r = 0; r < config->repetitions; r++) {
+    variance += (samples[r] - mean) * (samples[r] - mean);
+  }
+  if (config->repetitions > 1) {
+    variance /= config->repetitions - 1;
+  }
+
+  qsort(samples, config->repetitions, sizeof(double), bench_compare);
+  double median = samples[config->repetitions / 2];
+
+  printf("%-28s %7d %9.2f %9.2f %9.2f %8.2f %10.2f\n", name, batch,
+         samples[0], median, mean, sqrt(variance), 1e3 / median);
+
+  if (config->save_baseline) {
+    fprintf(config->save_baseline, "%s %d %.4f\n", name, batch, median);
+  }
+  for (int i = 0; i < config->baseline_count; i++) {
+    const struct BenchBaseline *base = &config->baseline[i];
+    if (base->batch == batch && strcmp(base->name, name) == 0 &&
+        median > base->median * (1.0 + config->tolerance)) {
+      fprintf(stderr, "REGRESSION %s %d: median %.2f ns, baseline %.2f ns (+%.0f%%)\n",
+              name, batch, median, base->median, (median / base->median - 1.0) * 100.0);
+      bench_regressions++;
+    }
+  }
+}
+
+static void bench_load_baseline(struct BenchConfig *config, const char *path) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "Error: unable to open baseline '%s'\n", path);
+    exit(1);
+  }
+  struct BenchBaseline entry;
+  while (fscanf(file, "%63s %d %lf", entry.name, &entry.batch, &entry.median) == 3) {
+    if (config->baseline_count == BENCH_MAX_BASELINE) {
+      fprintf(stderr, "Error: more than %d entries in baseline '%s'\n", BENCH_MAX_BASELINE, path);
+      exit(1);
+    }
+    config->baseline[config->baseline_count++] = entry;
+  }
+  if (!feof(file) || config->baseline_count == 0) {
+    fprintf(stderr, "Error: malformed baseline '%s'\n", path);
+    exit(1);
+  }
+  fclose(file);
+}
+
+/* Matrix benchmarks: batch = number of matrices, the large batches no
+ * longer fit in cache */
+struct MatrixState {
+  int count;
+  GLfloat *a;
+  GLfloat *b;
+  GLfloat *out;
+  GLfloat *angles;
+};
+
+static void matrix_state_init(struct MatrixState *state, int count) {
+  state->count = count;
+  state->a = bench_alloc(sizeof(GLfloat) * 16 * count);
+  state->b = bench_alloc(sizeof(GLfloat) * 16 * count);
+  state->out = bench_alloc(sizeof(GLfloat) * 24 * count);
+  state->angles = bench_alloc(sizeof(GLfloat) * count);
+  bench_random_fill(state->a, 16 * count, 1);
+  bench_random_fill(state->b, 16 * count, 2);
+  bench_random_fill(state->angles, count, 3);
+  for (int i = 0; i < count; i++) {
+    state->angles[i] *= 360.0f;
+  }
+}
+
+static void matrix_state_destroy(struct MatrixState *state) {
+  free(state->a);
+  free(state->b);
+  free(state->out);
+  free(state->angles);
+}
+
+static long bench_matrix_mul(void *arg) {
+  struct MatrixState *state = arg;
+  for (int i = 0; i < state->count; i++) {
+    matrix_mul(&state->out[i * 16], &state->a[i * 16], &state->b[i * 16]);
+  }
+  bench_sink += state->out[5];
+  return state->count;
+}
+
+static long bench_matrix_rotate_z(void *arg) {
+  struct MatrixState *state = arg;
+  for (int i = 0; i < state->count; i++) {
+    matrix_make_rotate_z(&state->out[i * 16], state->angles[i]);
+  }
+  bench_sink += state->out[1];
+  return state->count;
+}
+
+static long bench_matrix_scale(void *arg) {
+  struct MatrixState *state = arg;
+  for (int i = 0; i < state->count; i++) {
+    GLfloat s = state->angles[i];
+    matrix_make_scale(&state->out[i * 16], s, s, s);
+  }
+  bench_sink += state->out[0];
+  return state->count;
+}
+
+static long bench_matrix_frustum_planes(void *arg) {
+  struct MatrixState *state = arg;
+  for (int i = 0; i < state->count; i++) {
+    matrix_frustum_planes(&state->out[i * 24], &state->a[i * 16]);
+  }
+  bench_sink += state->out[3];
+  return state->count;
+}
+
+/* Scene graph: batch = node count of a four way tree. The root is touched
+ * before every update so all nodes get recomputed. */
+struct SceneState {
+  SceneGraph graph;
+  GLfloat root[16];
+};
+
+static void scene_state_init(struct SceneState *state, int count, int threads) {
+  GLfloat local[16];
+  uint32_t seed = 4;
+
+  scene_graph_init(&state->graph, count);
+  for (int i = 0; i < count; i++) {
+    matrix_make_rotate_z(local, bench_random(&seed) * 180.0f);
+    local[12] = bench_random(&seed);
+    local[13] = bench_random(&seed);
+    scene_graph_add_node(&state->graph, i == 0 ? SCENE_NO_PARENT : (i - 1) / 4, local);
+  }
+  matrix_make_identity(state->root);
+  scene_graph_start_workers(&state->graph, threads);
+}
+
+static long bench_scene_update(void *arg) {
+  struct SceneState *state = arg;
+  scene_graph_set_local(&state->graph, 0, state->root);
+  long updated = scene_graph_update_threaded(&state->graph);
+  bench_sink += scene_graph_world(&state->graph, state->graph.count - 1)[12];
+  return updated;
+}
+
+/* Geometry: batch = grid quads per side or sphere slices, ops = vertices */
+static long bench_geometry_grid(void *arg) {
+  Geometry geometry;
+  geometry_make_grid(&geometry, *(int*)arg, 1.0);
+  bench_sink += geometry.positions[3];
+  long vertices = geometry.vertex_count;
+  geometry_destroy(&geometry);
+  return vertices;
+}
+
+static long bench_geometry_sphere(void *arg) {
+  Geometry geometry;
+  geometry_make_sphere(&geometry, *(int*)arg, *(int*)arg / 2, 1.0);
+  bench_sink += geometry.positions[3];
+  long vertices = geometry.vertex_count;
+  geometry_destroy(&geometry);
+  return vertices;
+}
+
+static void run_benchmarks(const struct BenchConfig *config) {
+  static const int matrix_batches[] = { 1, 64, 4096, 65536 };
+  /* The threaded update runs serially below 4096 nodes, so it starts there */
+  static const int scene_batches[] = { 64, 4096, 65536 };
+  static const int scene_threaded_batches[] = { 4096, 65536 };
+  static const int geometry_batches[] = { 8, 64, 256 };
+  static const struct {
+    const char *name;
+    bench_batch_t run;
+  } matrix_benches[] = {
+    { "matrix_mul", bench_matrix_mul },
+    { "matrix_make_rotate_z", bench_matrix_rotate_z },
+    { "matrix_make_scale", bench_matrix_scale },
+    { "matrix_frustum_planes", bench_matrix_frustum_planes },
+  };
+
+  printf("%-28s %7s %9s %9s %9s %8s %10s\n", "benchmark", "batch", "min ns", "median", "mean", "stddev", "Mop/s");
+
+  for (size_t m = 0; m < sizeof(matrix_benches) / sizeof(matrix_benches[0]); m++) {
+    for (size_t b = 0; b < sizeof(matrix_batches) / sizeof(matrix_batches[0]); b++) {
+      struct MatrixState state;
+      matrix_state_init(&state, matrix_batches[b]);
+      bench_run(config, matrix_benches[m].name, matrix_batches[b], matrix_benches[m].run, &state);
+      matrix_state_destroy(&state);
+    }
+  }
+
+  for (size_t b = 0; b < sizeof(scene_batches) / sizeof(scene_batches[0]); b++) {
+    struct SceneState state;
+    scene_state_init(&state, scene_batches[b], 1);
+    bench_run(config, "scene_graph_update", scene_batches[b], bench_scene_update, &state);
+    scene_graph_destroy(&state.graph);
+  }
+  for (size_t b = 0; b < sizeof(scene_threaded_batches) / sizeof(scene_threaded_batches[0]); b++) {
+    struct SceneState state;
+    scene_state_init(&state, scene_threaded_batches[b], 4);
+    bench_run(config, "scene_graph_update_4threads", scene_threaded_batches[b], bench_scene_update, &state);
+    scene_graph_destroy(&state.graph);
+  }
+
+  for (size_t b = 0; b < sizeof(geometry_batches) / sizeof(geometry_batches[0]); b++) {
+    int size = geometry_batches[b];
+    bench_run(config, "geometry_make_grid", size, bench_geometry_grid, &size);
+    bench_run(config, "geometry_make_sphere", size, bench_geometry_sphere, &size);
+  }
+}
+
+#define CHECK(cond, ...)                                   \
+  do {                                                     \
+    if (!(cond)) {                                         \
+      fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+      fprintf(stderr, __VA_ARGS__);                        \
+      fprintf(stderr, "\n");                               \
+      check_failures++;                                    \
+    }                                                      \
+  } while (0)
+
+static int nearly_equal(double a, double b, double tolerance) {
+  return fabs(a - b) <= tolerance * fmax(1.0, fmax(fabs(a), fabs(b)));
+}
+
+static int matrix_nearly_equal(const GLfloat *a, const GLfloat *b, double tolerance) {
+  for (int i = 0; i < 16; i++) {
+    if (!nearly_equal(a[i], b[i], tolerance)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void reference_mul(GLfloat *prod, const GLfloat *a, const GLfloat *b) {
+  for (int col = 0; col < 4; col++) {
+    for (int row = 0; row < 4; row++) {
+      double sum = 0.0;
+      for (int k = 0; k < 4; k++) {
+        sum += (double)a[k * 4 + row] * b[col * 4 + k];
+      }
+      prod[col * 4 + row] = sum;
+    }
+  }
+}
+
+static void check_matrix(void) {
+  static const GLfloat diagonal[4] = { 2.0, 3.0, 4.0, 1.0 };
+  GLfloat identity[16], a[16], b[16], prod[16], expected[16];
+  uint32_t seed = 5;
+
+  matrix_make_identity(identity);
+  for (int i = 0; i < 16; i++) {
+    CHECK(identity[i] == (i % 5 == 0 ? 1.0f : 0.0f), "identity[%d] = %f", i, identity[i]);
+  }
+
+  for (int trial = 0; trial < 1000; trial++) {
+    for (int i = 0; i < 16; i++) {
+      a[i] = bench_random(&seed) * 10.0f;
+      b[i] = bench_random(&seed) * 10.0f;
+    }
+    matrix_mul(prod, a, b);
+    reference_mul(expected, a, b);
+    CHECK(matrix_nearly_equal(prod, expected, 1e-5), "matrix_mul differs from reference (trial %d)", trial);
+
+    matrix_mul(prod, a, identity);
+    CHECK(matrix_nearly_equal(prod, a, 0.0), "a * identity != a (trial %d)", trial);
+    matrix_mul(prod, identity, a);
+    CHECK(matrix_nearly_equal(prod, a, 0.0), "identity * a != a (trial %d)", trial);
+
+    /* The product may overwrite an input */
+    memcpy(prod, a, sizeof(a));
+    matrix_mul(prod, prod, b);
+    CHECK(matrix_nearly_equal(prod, expected, 1e-5), "matrix_mul in place differs (trial %d)", trial);
+  }
+
+  for (double angle = -720.0; angle <= 720.0; angle += 7.5) {
+    double radians = angle * M_PI / 180.0;
+    matrix_make_rotate_z(prod, angle);
+    CHECK(fabs(prod[0] - cos(radians)) < 1e-5 && fabs(prod[1] - sin(radians)) < 1e-5 &&
+          fabs(prod[4] + sin(radians)) < 1e-5 && fabs(prod[5] - cos(radians)) < 1e-5,
+          "rotate_z(%g) = [%f %f; %f %f]", angle, prod[0], prod[4], prod[1], prod[5]);
+    CHECK(prod[10] == 1.0f && prod[15] == 1.0f && prod[2] == 0.0f && prod[12] == 0.0f,
+          "rotate_z(%g) touches more than the xy block", angle);
+
+    matrix_make_rotate_z(a, angle);
+    matrix_make_rotate_z(b, 30.0);
+    matrix_mul(prod, a, b);
+    matrix_make_rotate_z(expected, angle + 30.0);
+    CHECK(matrix_nearly_equal(prod, expected, 1e-5), "rotate_z(%g) * rotate_z(30) != rotate_z(%g)", angle, angle + 30.0);
+  }
+
+  matrix_make_scale(prod, 2.0, 3.0, 4.0);
+  for (int i = 0; i < 16; i++) {
+    CHECK(prod[i] == (i % 5 == 0 ? diagonal[i / 5] : 0.0f), "scale[%d] = %f", i, prod[i]);
+  }
+}
+
+static GLfloat plane_distance(const GLfloat *plane, GLfloat x, GLfloat y, GLfloat z) {
+  return plane[0] * x + plane[1] * y + plane[2] * z + plane[3];
+}
+
+static void check_frustum_planes(void) {
+  GLfloat mvp[16], planes[24];
+
+  /* Identity: the clip cube itself, one unit from the origin on every side */
+  matrix_make_identity(mvp);
+  matrix_frustum_planes(planes, mvp);
+  for (int i = 0; i < 6; i++) {
+    const GLfloat *plane = &planes[i * 4];
+    GLfloat length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+    CHECK(nearly_equal(length, 1.0, 1e-6), "plane %d not normalized (%f)", i, length);
+    CHECK(nearly_equal(plane_distance(plane, 0, 0, 0), 1.0, 1e-6), "plane %d origin distance %f", i, plane_distance(plane, 0, 0, 0));
+  }
+  CHECK(plane_distance(&planes[0], -2.0, 0.0, 0.0) < 0.0, "x = -2 not outside the left plane");
+  CHECK(plane_distance(&planes[4], 2.0, 0.0, 0.0) < 0.0, "x = 2 not outside the right plane");
+  CHECK(plane_distance(&planes[16], 0.0, 0.0, 0.5) > 0.0, "z = 0.5 not inside the near plane");
+
+  /* Scaling the view down by half pushes the side planes out to 2 */
+  matrix_make_scale(mvp, 0.5, 0.5, 1.0);
+  matrix_frustum_planes(planes, mvp);
+  CHECK(fabs(plane_distance(&planes[0], -2.0, 0.0, 0.0)) < 1e-6, "left plane not at x = -2");
+  CHECK(fabs(plane_distance(&planes[12], 0.0, 2.0, 0.0)) < 1e-6, "top plane not at y = 2");
+}
+
+static void check_scene_states_equal(const struct SceneState *serial, const struct SceneState *threaded,
+                                     const char *what) {
+  CHECK(serial->graph.count == threaded->graph.count, "%s: node counts differ", what);
+  for (int i = 0; i < serial->graph.count; i++) {
+    if (!matrix_nearly_equal(scene_graph_world(&serial->graph, i), scene_graph_world(&threaded->graph, i), 0.0)) {
+      CHECK(0, "%s: threaded world matrix %d differs", what, i);
+      break;
+    }
+  }
+}
+
+static void check_scene_graph(void) {
+  SceneGraph graph;
+  GLfloat rot[16], scale[16], tmp[16], expected[16];
+
+  matrix_make_rotate_z(rot, 45.0);
+  matrix_make_scale(scale, 0.5, 0.5, 0.5);
+
+  scene_graph_init(&graph, 3);
+  int root = scene_graph_add_node(&graph, SCENE_NO_PARENT, rot);
+  int child = scene_graph_add_node(&graph, root, scale);
+  int leaf = scene_graph_add_node(&graph, child, rot);
+
+  CHECK(scene_graph_update(&graph) == 3, "first update should touch every node");
+  CHECK(scene_graph_update(&graph) == 0, "update without changes should be free");
+
+  matrix_mul(tmp, rot, scale);
+  matrix_mul(expected, tmp, rot);
+  CHECK(matrix_nearly_equal(scene_graph_world(&graph, leaf), expected, 1e-6), "leaf world matrix wrong");
+
+  scene_graph_set_local(&graph, child, rot);
+  CHECK(scene_graph_update(&graph) == 2, "changing the middle node should update it and the leaf");
+  matrix_mul(tmp, rot, rot);
+  matrix_mul(expected, tmp, rot);
+  CHECK(matrix_nearly_equal(scene_graph_world(&graph, leaf), expected, 1e-6), "leaf not updated");
+  CHECK(matrix_nearly_equal(scene_graph_world(&graph, root), rot, 0.0), "root changed without being dirty");
+  scene_graph_destroy(&graph);
+
+  /* The threaded update has to agree with the serial one exactly */
+  struct SceneState serial, threaded;
+  scene_state_init(&serial, SCENE_CHECK_NODES, 1);
+  scene_state_init(&threaded, SCENE_CHECK_NODES, 4);
+  CHECK(bench_scene_update(&serial) == SCENE_CHECK_NODES, "serial update count");
+  CHECK(bench_scene_update(&threaded) == SCENE_CHECK_NODES, "threaded update count");
+  check_scene_states_equal(&serial, &threaded, "full update");
+
+  /* Only a subtree dirty: node 1 and its descendants */
+  scene_graph_set_local(&serial.graph, 1, rot);
+  scene_graph_set_local(&threaded.graph, 1, rot);
+  int serial_updated = scene_graph_update(&serial.graph);
+  int threaded_updated = scene_graph_update_threaded(&threaded.graph);
+  CHECK(serial_updated == threaded_updated && serial_updated > 1 && serial_updated < SCENE_CHECK_NODES,
+        "subtree update counts %d/%d", serial_updated, threaded_updated);
+  check_scene_states_equal(&serial, &threaded, "subtree update");
+
+  /* Growing the graph between threaded updates rebuilds the schedule while
+   * the workers are parked.
+   */
+  uint32_t seed = 11;
+  for (int round = 0; round < 8; round++) {
+    for (int i = 0; i < 1000; i++) {
+      int parent = (int)((bench_random(&seed) + 1.0f) * 0.5f * serial.graph.count) % serial.graph.count;
+      scene_graph_add_node(&serial.graph, parent, scale);
+      scene_graph_add_node(&threaded.graph, parent, scale);
+    }
+    serial_updated = scene_graph_update(&serial.graph);
+    threaded_updated = scene_graph_update_threaded(&threaded.graph);
+    CHECK(serial_updated == threaded_updated, "round %d update counts %d/%d", round, serial_updated, threaded_updated);
+    check_scene_states_equal(&serial, &threaded, "update after adding nodes");
+  }
+
+  scene_graph_destroy(&serial.graph);
+  scene_graph_destroy(&threaded.graph);
+}
+
+static void check_geometry_indices(const Geometry *geometry, const char *name) {
+  for (int i = 0; i < geometry->index_count; i++) {
+    if (geometry->indices[i] >= (GLuint)geometry->vertex_count) {
+      CHECK(0, "%s index %d out of range (%u)", name, i, geometry->indices[i]);
+      return;
+    }
+  }
+}
+
+static void check_geometry(void) {
+  Geometry geometry;
+
+  geometry_make_grid(&geometry, 4, 0.5);
+  CHECK(geometry.vertex_count == 25 && geometry.index_count == 96, "grid counts %d/%d", geometry.vertex_count, geometry.index_count);
+  CHECK(nearly_equal(geometry.coverage, 0.25, 1e-6), "grid coverage %f", geometry.coverage);
+  CHECK(geometry.positions[0] == -0.5f && geometry.positions[24 * 3] == 0.5f, "grid extent");
+  check_geometry_indices(&geometry, "grid");
+  geometry_destroy(&geometry);
+
+  geometry_make_sphere(&geometry, 16, 8, 0.75);
+  CHECK(geometry.vertex_count == 17 * 9 && geometry.index_count == 16 * 8 * 6, "sphere counts %d/%d", geometry.vertex_count, geometry.index_count);
+  for (int v = 0; v < geometry.vertex_count; v++) {
+    const GLfloat *p = &geometry.positions[v * 3];
+    if (!nearly_equal(sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]), 0.75, 1e-5)) {
+      CHECK(0, "sphere vertex %d off the surface", v);
+      break;
+    }
+  }
+  check_geometry_indices(&geometry, "sphere");
+  geometry_destroy(&geometry);
+
+  geometry_make_quad_stack(&geometry, 8, 1.0);
+  CHECK(geometry.vertex_count == 32 && geometry.index_count == 48, "quad stack counts %d/%d", geometry.vertex_count, geometry.index_count);
+  CHECK(nearly_equal(geometry.coverage, 8.0, 1e-6), "quad stack coverage %f", geometry.coverage);
+  check_geometry_indices(&geometry, "quad stack");
+  geometry_destroy(&geometry);
+}
+
+static void ktx_patch(unsigned char *file, int field, uint32_t value) {
+  memcpy(file + 12 + 4 * field, &value, sizeof(value));
+}
+
+static void check_ktx(void) {
+  unsigned char pixels[4 * 4 * 4];
+  const void *level_data[3] = { pixels, pixels, pixels };
+  const size_t level_size[3] = { 4 * 4 * 4, 2 * 2 * 4, 1 * 1 * 4 };
+  size_t size;
+  KtxImage image;
+
+  for (size_t i = 0; i < sizeof(pixels); i++) {
+    pixels[i] = (unsigned char)i;
+  }
+  unsigned char *file = ktx_build(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, 4, 3, level_data, level_size, &size);
+  CHECK(size == 64 + 4 * 3 + 64 + 16 + 4, "ktx file size %zu", size);
+
+  const char *error = ktx_parse(file, size, &image);
+  CHECK(error == NULL, "valid ktx rejected: %s", error);
+  if (error == NULL) {
+    CHECK(image.internal_format == GL_RGBA8 && image.format == GL_RGBA && image.type == GL_UNSIGNED_BYTE,
+          "ktx formats 0x%x/0x%x/0x%x", image.internal_format, image.format, image.type);
+    CHECK(image.width == 4 && image.height == 4 && image.levels == 3, "ktx size %dx%d, %d levels",
+          image.width, image.height, image.levels);
+    for (int i = 0; i < 3; i++) {
+      CHECK(image.level_size[i] == level_size[i], "ktx level %d size %zu", i, image.level_size[i]);
+      CHECK(image.level_offset[i] + image.level_size[i] <= size &&
+            memcmp(file + image.level_offset[i], pixels, level_size[i]) == 0, "ktx level %d data", i);
+    }
+  }
+  CHECK(ktx_parse(file, size - 1, &image) != NULL, "truncated ktx accepted");
+
+  /* Header fields are native endian u32s after the 12 byte identifier */
+  enum { HEADER_GL_TYPE = 1, HEADER_GL_INTERNAL_FORMAT = 4, HEADER_WIDTH = 6, HEADER_MIPMAP_LEVELS = 11 };
+  const struct {
+    int field;
+    uint32_t value;
+    const char *name;
+  } bad_headers[] = {
+    { HEADER_WIDTH, 0, "zero width" },
+    { HEADER_WIDTH, 1 << 20, "huge width" },
+    { HEADER_GL_INTERNAL_FORMAT, GL_RGBA, "unsized internal format" },
+    { HEADER_GL_TYPE, 0, "compressed data in a non-ETC2 format" },
+    { HEADER_MIPMAP_LEVELS, 4, "more levels than the size allows" },
+  };
+  for (size_t i = 0; i < sizeof(bad_headers) / sizeof(bad_headers[0]); i++) {
+    unsigned char *bad = malloc(size);
+    memcpy(bad, file, size);
+    ktx_patch(bad, bad_headers[i].field, bad_headers[i].value);
+    CHECK(ktx_parse(bad, size, &image) != NULL, "ktx with %s accepted", bad_headers[i].name);
+    free(bad);
+  }
+
+  file[1] = 'X';
+  CHECK(ktx_parse(file, size, &image) != NULL, "ktx with a bad identifier accepted");
+  free(file);
+}
+
+/* Builds a file with the given level sizes and returns what ktx_parse says */
+static const char *ktx_parse_built(GLenum internal_format, GLenum format, GLenum type, int width, int height,
+                                   int levels, const size_t *level_size, int truncate, KtxImage *image) {
+  static const unsigned char data[256];
+  const void *level_data[KTX_MAX_LEVELS];
+  size_t size;
+
+  for (int i = 0; i < levels; i++) {
+    level_data[i] = data;
+  }
+  unsigned char *file = ktx_build(internal_format, format, type, width, height, levels, level_data, level_size, &size);
+  const char *error = ktx_parse(file, size - truncate, image);
+  free(file);
+  return error;
+}
+
+static void check_ktx_level_sizes(void) {
+  KtxImage image;
+  const char *error;
+
+  /* ETC2 RGB: 8 bytes per 4x4 block, levels below 4x4 still take a block */
+  const size_t etc2_sizes[4] = { 32, 8, 8, 8 };
+  error = ktx_parse_built(GL_COMPRESSED_RGB8_ETC2, 0, 0, 8, 8, 4, etc2_sizes, 0, &image);
+  CHECK(error == NULL, "valid ETC2 ktx rejected: %s", error);
+  CHECK(image.format == 0 && image.internal_format == GL_COMPRESSED_RGB8_ETC2 && image.levels == 4,
+        "ETC2 ktx parsed as 0x%x/0x%x, %d levels", image.format, image.internal_format, image.levels);
+  for (int i = 0; i < 4 && error == NULL; i++) {
+    CHECK(image.level_size[i] == etc2_sizes[i], "ETC2 level %d size %zu", i, image.level_size[i]);
+  }
+  CHECK(ktx_parse_built(GL_COMPRESSED_RGB8_ETC2, 0, 0, 8, 8, 4, etc2_sizes, 1, &image) != NULL,
+        "truncated ETC2 ktx accepted");
+
+  /* RGBA8 ETC2 + EAC: 16 bytes per block, partial blocks round up */
+  const size_t eac_size[1] = { 2 * 1 * 16 };
+  error = ktx_parse_built(GL_COMPRESSED_RGBA8_ETC2_EAC, 0, 0, 5, 3, 1, eac_size, 0, &image);
+  CHECK(error == NULL, "valid 5x3 ETC2 EAC ktx rejected: %s", error);
+
+  /* Uncompressed rows are padded to 4 bytes */
+  const size_t rgb_size[1] = { 12 * 3 };
+  error = ktx_parse_built(GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 3, 3, 1, rgb_size, 0, &image);
+  CHECK(error == NULL, "valid 3x3 RGB8 ktx rejected: %s", error);
+
+  const struct {
+    GLenum internal_format, format, type;
+    int width, height, levels;
+    size_t level_size[4];
+    const char *name;
+  } bad_sizes[] = {
+    { GL_COMPRESSED_RGB8_ETC2, 0, 0, 8, 8, 4, { 16, 8, 8, 8 }, "short ETC2 level" },
+    { GL_COMPRESSED_RGB8_ETC2, 0, 0, 8, 8, 4, { 32, 0, 8, 8 }, "empty ETC2 level" },
+    { GL_COMPRESSED_RGBA8_ETC2_EAC, 0, 0, 8, 8, 1, { 32 }, "EAC level sized for 8 byte blocks" },
+    { GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 3, 3, 1, { 27 }, "RGB8 level without row padding" },
+    { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, 4, 1, { 60 }, "short RGBA8 level" },
+    { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, 4, 1, { 0 }, "empty RGBA8 level" },
+  };
+  for (size_t i = 0; i < sizeof(bad_sizes) / sizeof(bad_sizes[0]); i++) {
+    error = ktx_parse_built(bad_sizes[i].internal_format, bad_sizes[i].format, bad_sizes[i].type,
+                            bad_sizes[i].width, bad_sizes[i].height, bad_sizes[i].levels,
+                            bad_sizes[i].level_size, 0, &image);
+    CHECK(error != NULL, "ktx accepted: %s", bad_sizes[i].name);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  struct BenchConfig config = { 15, 50000000, 20000000, NULL };
+  config.tolerance = 0.25;
+  int do_check = 0, do_bench = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-check") == 0) {
+      do_check = 1;
+    } else if (strcmp(argv[i], "-bench") == 0) {
+      do_bench = 1;
+    } else if (strcmp(argv[i], "-quick") == 0) {
+      config.repetitions = 5;
+      config.warmup_ns = 2000000;
+      config.repetition_ns = 1000000;
+    } else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc) {
+      config.filter = argv[i + 1];
+      i++;
+    } else if (strcmp(argv[i], "-baseline") == 0 && i + 1 < argc) {
+      bench_load_baseline(&config, argv[i + 1]);
+      i++;
+    } else if (strcmp(argv[i], "-tolerance") == 0 && i + 1 < argc) {
+      config.tolerance = atof(argv[i + 1]) / 100.0;
+      i++;
+    } else if (strcmp(argv[i], "-save-baseline") == 0 && i + 1 < argc) {
+      config.save_baseline = fopen(argv[i + 1], "w");
+      if (!config.save_baseline) {
+        fprintf(stderr, "Error: unable to create baseline '%s'\n", argv[i + 1]);
+        exit(1);
+      }
+      i++;
+    } else {
+      printf("Usage:\n");
+      printf("  -check                  run the correctness checks\n");
+      printf("  -bench                  run the benchmarks\n");
+      printf("  -quick                  fewer and shorter repetitions\n");
+      printf("  -filter <substring>     only run benchmarks whose name contains substring\n");
+      printf("  -save-baseline <file>   write the benchmark medians to file\n");
+      printf("  -baseline <file>        fail if a median got slower than in file\n");
+      printf("  -tolerance <percent>    allowed slowdown against the baseline (default 25)\n");
+      printf("Without -check or -bench both run\n");
+      exit(-1);
+    }
+  }
+  if (!do_check && !do_bench) {
+    do_check = do_bench = 1;
+  }
+
+  if (do_check) {
+    check_matrix();
+    check_frustum_planes();
+    check_scene_graph();
+    check_geometry();
+    check_ktx();
+    check_ktx_level_sizes();
+    printf("Checks: %s (%d failures)\n", check_failures ? "FAILED" : "passed", check_failures);
+  }
+  if (do_bench) {
+    run_benchmarks(&config);
+    if (config.save_baseline) {
+      fclose(config.save_baseline);
+    }
+    if (config.baseline_count) {
+      printf("Baseline: %s (%d regressions)\n", bench_regressions ? "FAILED" : "passed", bench_regressions);
+    }
+  }
+
+  return (check_failures || bench_regressions) ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "frame_pacing.h"
+
+void frame_stats_init(FrameStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+
+void frame_stats_destroy(FrameStats *stats) {
+  free(stats->samples);
+  memset(stats, 0, sizeof(*stats));
+}
+
+void frame_stats_add(FrameStats *stats, uint64_t frame_ns) {
+  if (stats->count == stats->capacity) {
+    stats->capacity = stats->capacity ? stats->capacity * 2 : 1024;
+    stats->samples = realloc(stats->samples, sizeof(uint64_t) * stats->capacity);
+    if (!stats->samples) {
+      fprintf(stderr, "Error: out of memory for frame statistics\n");
+      exit(1);
+    }
+  }
+  stats->samples[stats->count++] = frame_ns;
+}
+
+void frame_stats_tick(FrameStats *stats, uint64_t now_ns) {
+  if (stats->last) {
+    frame_stats_add(stats, now_ns - stats->last);
+  }
+  stats->last = now_ns;
+}
+
+static int frame_stats_compare(const void *a, const void *b) {
+  uint64_t lhs = *(const uint64_t*)a;
+  uint64_t rhs = *(const uint64_t*)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+void frame_stats_report(const FrameStats *stats, const char *label) {
+  if (stats->count == 0) {
+    printf("%s: no frames measured\n", label);
+    return;
+  }
+
+  uint64_t *sorted = malloc(sizeof(uint64_t) * stats->count);
+  memcpy(sorted, stats->samples, sizeof(uint64_t) * stats->count);
+  qsort(sorted, stats->count, sizeof(uint64_t), frame_stats_compare);
+
+  uint64_t total = 0;
+  for (int i = 0; i < stats->count; i++) {
+    total += sorted[i];
+  }
+
+  printf("%s: %d frames in %.3f s (%.1f fps)\n", label, stats->count, total / 1e9, stats->count * 1e9 / total);
+  printf("%s: frame ms min %.3f avg %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n", label,
+         sorted[0] / 1e6,
+         (double)total / stats->count / 1e6,
+         sorted[stats->count / 2] / 1e6,
+         sorted[(int)(stats->count * 0.95)] / 1e6,
+         sorted[(int)(stats->count * 0.99)] / 1e6,
+         sorted[stats->count - 1] / 1e6);
+
+  free(sorted);
+}
+
+void bench_target_init(BenchTarget *target, int width, int height) {
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target->previous_fbo);
+
+  glGenRenderbuffers(1, &target->color);
+  glBindRenderbuffer(GL_RENDERBUFFER, target->color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glGenFramebuffers(1, &target->fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->color);
+  glViewport(0, 0, width, height);
+}
+
+void bench_target_destroy(BenchTarget *target) {
+  glBindFramebuffer(GL_FRAMEBUFFER, target->previous_fbo);
+  glDeleteFramebuffers(1, &target->fbo);
+  glDeleteRenderbuffers(1, &target->color);
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+  double lhs = *(const double*)a;
+  double rhs = *(const double*)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+double bench_gpu_time_ms(bench_draw_t draw, void *user_data, int iterations, int repetitions) {
+  double *times = malloc(sizeof(double) * repetitions);
+  if (!times) {
+    fprintf(stderr, "Error: out of memory for benchmark timings\n");
+    exit(1);
+  }
+
+  draw(user_data);
+  glFinish();
+
+  for (int r = 0; r < repetitions; r++) {
+    uint64_t start = frame_pacer_now_ns();
+    for (int i = 0; i < iterations; i++) {
+      draw(user_data);
+    }
+    glFinish();
+    times[r] = (frame_pacer_now_ns() - start) / 1e6 / iterations;
+  }
+
+  qsort(times, repetitions, sizeof(double), bench_compare_double);
+  double median = times[repetitions / 2];
+  free(times);
+  return median;
+}
@@ -0,0 +1,67 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <GLES3/gl31.h>
+
+/* Collects frame times and prints a summary with percentiles */
+typedef struct {
+  uint64_t *samples;
+  int count;
+  int capacity;
+  uint64_t last;
+} FrameStats;
+
+void frame_stats_init(FrameStats *stats);
+void frame_stats_destroy(FrameStats *stats);
+/* Records one frame that took frame_ns */
+void frame_stats_add(FrameStats *stats, uint64_t frame_ns);
+/* Records the time since the previous call, the first call only starts the clock */
+void frame_stats_tick(FrameStats *stats, uint64_t now_ns);
+void frame_stats_report(const FrameStats *stats, const char *label);
+
+/* Fixed size offscreen target for GPU benchmarks, so the window doesn't
+ * matter. Init binds it and sets the viewport, destroy binds back whatever
+ * framebuffer was bound before.
+ */
+typedef struct {
+  GLuint fbo;
+  GLuint color;
+  GLint previous_fbo;
+} BenchTarget;
+
+void bench_target_init(BenchTarget *target, int width, int height);
+void bench_target_destroy(BenchTarget *target);
+
+typedef void (*bench_draw_t)(void *user_data);
+
+/* Draws once to warm up (compiles and uploads whatever the driver deferred),
+ * then times batches of iterations draws until glFinish returns. Returns the
+ * median milliseconds per draw over repetitions batches.
+ */
+double bench_gpu_time_ms(bench_draw_t draw, void *user_data, int iterations, int repetitions);
+
+#endif /* BENCH_H */
@@ -0,0 +1,214 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "example_registry.h"
+#include "geometry.h"
+#include "matrix.h"
+#include "render_common.h"
+#include "shaders.h"
+#include "trace.h"
+
+/* Sweeps generated geometry over vertex count, screen coverage and overdraw
+ * and prints vertices/s and pixels/s for each point (median of
+ * SWEEP_REPETITIONS batches), which shows where a GPU turns from vertex
+ * bound to fill bound. Then shows a sphere.
+ */
+
+#define SWEEP_SIZE 512
+#define SWEEP_ITERATIONS 8
+#define SWEEP_REPETITIONS 5
+
+enum sweep_shape {
+  SHAPE_GRID,
+  SHAPE_SPHERE,
+  SHAPE_QUAD_STACK,
+};
+
+struct SweepPoint {
+  enum sweep_shape shape;
+  int tessellation;  /* grid quads per side, sphere slices or quad layers */
+  float extent;
+};
+
+static const struct SweepPoint sweep_points[] = {
+  { SHAPE_GRID, 1, 0.25 },   { SHAPE_GRID, 1, 1.0 },
+  { SHAPE_GRID, 16, 0.25 },  { SHAPE_GRID, 16, 1.0 },
+  { SHAPE_GRID, 128, 0.25 }, { SHAPE_GRID, 128, 1.0 },
+  { SHAPE_GRID, 512, 0.25 }, { SHAPE_GRID, 512, 1.0 },
+  { SHAPE_SPHERE, 16, 0.25 },  { SHAPE_SPHERE, 16, 1.0 },
+  { SHAPE_SPHERE, 128, 0.25 }, { SHAPE_SPHERE, 128, 1.0 },
+  { SHAPE_SPHERE, 512, 0.25 }, { SHAPE_SPHERE, 512, 1.0 },
+  { SHAPE_QUAD_STACK, 1, 1.0 },  { SHAPE_QUAD_STACK, 4, 1.0 },
+  { SHAPE_QUAD_STACK, 16, 1.0 }, { SHAPE_QUAD_STACK, 64, 1.0 },
+};
+
+struct GpuGeometry {
+  GLuint vao;
+  GLuint buffers[3];
+  int index_count;
+};
+
+struct SweepData {
+  GLuint program;
+  GLint u_matrix;
+  struct GpuGeometry sphere;
+};
+
+static void make_geometry(Geometry *geometry, const struct SweepPoint *point) {
+  switch (point->shape) {
+  case SHAPE_GRID:
+    geometry_make_grid(geometry, point->tessellation, point->extent);
+    break;
+  case SHAPE_SPHERE:
+    geometry_make_sphere(geometry, point->tessellation, point->tessellation / 2, point->extent);
+    break;
+  case SHAPE_QUAD_STACK:
+    geometry_make_quad_stack(geometry, point->tessellation, point->extent);
+    break;
+  }
+}
+
+static void upload_geometry(struct GpuGeometry *gpu, const Geometry *geometry) {
+  TRACE_SCOPE("upload_geometry");
+  gpu->index_count = geometry->index_count;
+
+  glGenVertexArrays(1, &gpu->vao);
+  glBindVertexArray(gpu->vao);
+  glGenBuffers(3, gpu->buffers);
+
+  glBindBuffer(GL_ARRAY_BUFFER, gpu->buffers[0]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * geometry->vertex_count, geometry->positions, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+  glEnableVertexAttribArray(0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, gpu->buffers[1]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 4 * geometry->vertex_count, geometry->colors, GL_STATIC_DRAW);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu->buffers[2]);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * geometry->index_count, geometry->indices, GL_STATIC_DRAW);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static void release_geometry(struct GpuGeometry *gpu) {
+  glDeleteBuffers(3, gpu->buffers);
+  glDeleteVertexArrays(1, &gpu->vao);
+}
+
+static void draw_geometry(const struct GpuGeometry *gpu) {
+  glBindVertexArray(gpu->vao);
+  glDrawElements(GL_TRIANGLES, gpu->index_count, GL_UNSIGNED_INT, (void*)0);
+  glBindVertexArray(0);
+}
+
+static void bench_draw_geometry(void *user_data) {
+  draw_geometry((const struct GpuGeometry*)user_data);
+}
+
+static void sweep(struct SweepData *data) {
+  TRACE_SCOPE("sweep");
+  static const char *shape_names[] = { "grid", "sphere", "quad-stack" };
+
+  BenchTarget target;
+  bench_target_init(&target, SWEEP_SIZE, SWEEP_SIZE);
+
+  GLfloat identity[16];
+  matrix_make_identity(identity);
+  glUseProgram(data->program);
+  glUniformMatrix4fv(data->u_matrix, 1, GL_FALSE, identity);
+
+  printf("%-10s %6s %6s %9s %9s %8s %10s %10s\n",
+         "shape", "tess", "extent", "vertices", "triangles", "coverage", "Mverts/s", "Mpixels/s");
+
+  for (size_t i = 0; i < sizeof(sweep_points) / sizeof(sweep_points[0]); i++) {
+    const struct SweepPoint *point = &sweep_points[i];
+    Geometry geometry;
+    struct GpuGeometry gpu;
+
+    make_geometry(&geometry, point);
+    upload_geometry(&gpu, &geometry);
+
+    double seconds = bench_gpu_time_ms(bench_draw_geometry, &gpu, SWEEP_ITERATIONS, SWEEP_REPETITIONS) / 1e3;
+    double vertices = (double)geometry.vertex_count;
+    double pixels = (double)geometry.coverage * SWEEP_SIZE * SWEEP_SIZE;
+    printf("%-10s %6d %6.2f %9d %9d %8.2f %10.2f %10.2f\n",
+           shape_names[point->shape], point->tessellation, point->extent,
+           geometry.vertex_count, geometry.index_count / 3, geometry.coverage,
+           vertices / seconds / 1e6, pixels / seconds / 1e6);
+
+    release_geometry(&gpu);
+    geometry_destroy(&geometry);
+  }
+
+  bench_target_destroy(&target);
+}
+
+static void init(const RenderContext renderCtx, void **user_data) {
+  static struct SweepData data;
+
+  data.program = shader_program_create(shader_get(SHADER_VERTEX_MVP),
+                                       shader_get(SHADER_FRAGMENT_PASSTHROUGH));
+  glBindAttribLocation(data.program, 0, "pos");
+  glBindAttribLocation(data.program, 1, "color");
+  glLinkProgram(data.program); /* needed to put attribs into effect */
+  data.u_matrix = glGetUniformLocation(data.program, "modelviewProjection");
+
+  sweep(&data);
+  glViewport(0, 0, renderCtx.window_size.width, renderCtx.window_size.height);
+
+  Geometry sphere;
+  geometry_make_sphere(&sphere, 32, 16, 0.8);
+  upload_geometry(&data.sphere, &sphere);
+  geometry_destroy(&sphere);
+
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(0.4, 0.4, 0.4, 0.0);
+  (*user_data) = (void*)&data;
+}
+
+static void draw(view_rotation_t rotation, void *user_data) {
+  struct SweepData *data = (struct SweepData*)user_data;
+
+  GLfloat mat[16];
+  matrix_make_rotate_z(mat, rotation.x);
+
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glUseProgram(data->program);
+  glUniformMatrix4fv(data->u_matrix, 1, GL_FALSE, mat);
+  draw_geometry(&data->sphere);
+}
+
+static void cleanup(void *user_data) {
+  struct SweepData *data = (struct SweepData*)user_data;
+
+  release_geometry(&data->sphere);
+  glDeleteProgram(data->program);
+}
+
+EXAMPLE_REGISTER(geometry_sweep, "geometry-sweep", init, draw, cleanup, NULL)
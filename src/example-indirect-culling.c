@@ -0,0 +1,266 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "example_registry.h"
+#include "matrix.h"
+#include "render_common.h"
+#include "shaders.h"
+#include "trace.h"
+
+/* GPU driven drawing: object bounds live in a storage buffer, a compute
+ * shader frustum culls them and appends the visible ones to an instance
+ * buffer while bumping instanceCount of the indirect command. The CPU
+ * only resets that counter and issues one indirect draw, nothing is read
+ * back. The indirect-culling-arrays variant uses glDrawArraysIndirect
+ * instead of glDrawElementsIndirect.
+ */
+
+#define OBJECT_GRID 64
+#define OBJECT_COUNT (OBJECT_GRID * OBJECT_GRID)
+#define CULL_GROUP_SIZE 64
+
+static const char *shader_compute_cull = SHADER_GLSLV(320,
+  layout(local_size_x = 64) in;
+  struct Object {
+    vec4 sphere;
+    vec4 color;
+  };
+  layout(std430, binding = 0) readonly buffer Objects { Object objects[]; };
+  layout(std430, binding = 1) writeonly buffer Visible { Object visible[]; };
+  layout(std430, binding = 2) buffer Command { uint command[]; };
+  uniform vec4 planes[6];
+  uniform uint object_count;
+  void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= object_count) {
+      return;
+    }
+    Object object = objects[id];
+    for (int i = 0; i < 6; i++) {
+      if (dot(planes[i].xyz, object.sphere.xyz) + planes[i].w < -object.sphere.w) {
+        return;
+      }
+    }
+    uint slot = atomicAdd(command[1], 1u);
+    visible[slot] = object;
+  };
+);
+
+static const char *shader_vertex_instanced = SHADER_GLSLV(320,
+  uniform mat4 modelviewProjection;
+  layout(location = 0) in vec2 pos;
+  layout(location = 1) in vec4 sphere;
+  layout(location = 2) in vec4 color;
+  out vec4 v_color;
+  void main() {
+    gl_Position = modelviewProjection * vec4(sphere.xy + pos * sphere.w, sphere.z, 1.0);
+    v_color = color;
+  };
+);
+
+struct Object {
+  GLfloat sphere[4];  /* center xyz, radius */
+  GLfloat color[4];
+};
+
+/* Both layouts start with count and instanceCount, the rest stays zero */
+struct IndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first;
+  GLuint base_vertex;  /* reservedMustBeZero for arrays */
+  GLuint reserved;     /* unused for arrays */
+};
+
+struct CullParams {
+  int draw_arrays;
+};
+
+struct CullData {
+  int draw_arrays;
+
+  GLuint cull_program;
+  GLint u_planes;
+  GLint u_object_count;
+
+  GLuint draw_program;
+  GLint u_matrix;
+
+  GLuint vao;
+  GLuint mesh_buffers[2];
+  GLuint objects;
+  GLuint visible;
+  GLuint command;
+};
+
+static void create_objects(struct CullData *data) {
+  TRACE_SCOPE("create_objects");
+  static struct Object objects[OBJECT_COUNT];
+
+  /* Grid wider than the view, so rotating moves objects in and out */
+  for (int y = 0; y < OBJECT_GRID; y++) {
+    for (int x = 0; x < OBJECT_GRID; x++) {
+      struct Object *object = &objects[y * OBJECT_GRID + x];
+      GLfloat u = (GLfloat)x / (OBJECT_GRID - 1), v = (GLfloat)y / (OBJECT_GRID - 1);
+      object->sphere[0] = u * 4.0 - 2.0;
+      object->sphere[1] = v * 4.0 - 2.0;
+      object->sphere[2] = 0.0;
+      object->sphere[3] = 1.0 / OBJECT_GRID;
+      object->color[0] = u;
+      object->color[1] = v;
+      object->color[2] = 1.0 - u;
+      object->color[3] = 1.0;
+    }
+  }
+
+  glGenBuffers(1, &data->objects);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, data->objects);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(objects), objects, GL_STATIC_DRAW);
+
+  glGenBuffers(1, &data->visible);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, data->visible);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(objects), NULL, GL_DYNAMIC_COPY);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+static void create_mesh(struct CullData *data) {
+  TRACE_SCOPE("create_mesh");
+  struct IndirectCommand command;
+  memset(&command, 0, sizeof(command));
+
+  glGenVertexArrays(1, &data->vao);
+  glBindVertexArray(data->vao);
+  glGenBuffers(2, data->mesh_buffers);
+  glBindBuffer(GL_ARRAY_BUFFER, data->mesh_buffers[0]);
+
+  if (data->draw_arrays) {
+    static const GLfloat quad[6][2] = {
+      { -1, -1 }, { 1, -1 }, { -1, 1 },
+      {  1, -1 }, { 1,  1 }, { -1, 1 },
+    };
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    command.count = 6;
+  } else {
+    static const GLfloat quad[4][2] = { { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } };
+    static const GLushort indices[6] = { 0, 1, 2, 1, 3, 2 };
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data->mesh_buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    command.count = 6;
+  }
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+  glEnableVertexAttribArray(0);
+
+  /* The compute shader's output doubles as the per-instance attributes */
+  glBindBuffer(GL_ARRAY_BUFFER, data->visible);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(struct Object), (void*)0);
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(struct Object), (void*)(sizeof(GLfloat) * 4));
+  glVertexAttribDivisor(1, 1);
+  glVertexAttribDivisor(2, 1);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glGenBuffers(1, &data->command);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, data->command);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+static void init(const RenderContext renderCtx, void **user_data) {
+  static struct CullData data;
+  const struct CullParams *params = renderCtx.callbacks.params;
+
+  data.draw_arrays = params->draw_arrays;
+
+  data.cull_program = shader_compute_program_create(shader_compute_cull);
+  data.u_planes = glGetUniformLocation(data.cull_program, "planes");
+  data.u_object_count = glGetUniformLocation(data.cull_program, "object_count");
+
+  data.draw_program = shader_program_create(shader_vertex_instanced, shader_get(SHADER_FRAGMENT_PASSTHROUGH));
+  data.u_matrix = glGetUniformLocation(data.draw_program, "modelviewProjection");
+
+  create_objects(&data);
+  create_mesh(&data);
+
+  glClearColor(0.4, 0.4, 0.4, 0.0);
+  (*user_data) = (void*)&data;
+}
+
+static void draw(view_rotation_t rotation, void *user_data) {
+  struct CullData *data = (struct CullData*)user_data;
+  static const GLuint zero = 0;
+
+  GLfloat mat[16], rot[16], scale[16], planes[24];
+  matrix_make_rotate_z(rot, rotation.x);
+  matrix_make_scale(scale, 0.8, 0.8, 0.8);
+  matrix_mul(mat, rot, scale);
+  matrix_frustum_planes(planes, mat);
+
+  /* Only the instance counter is reset, the GPU fills in the rest */
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, data->command);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(struct IndirectCommand, instance_count), sizeof(zero), &zero);
+
+  glUseProgram(data->cull_program);
+  glUniform4fv(data->u_planes, 6, planes);
+  glUniform1ui(data->u_object_count, OBJECT_COUNT);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, data->objects);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, data->visible);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, data->command);
+  glDispatchCompute((OBJECT_COUNT + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+  /* Buffer update: the next frame's glBufferSubData reset must land after the atomicAdd writes */
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glUseProgram(data->draw_program);
+  glUniformMatrix4fv(data->u_matrix, 1, GL_FALSE, mat);
+  glBindVertexArray(data->vao);
+  if (data->draw_arrays) {
+    glDrawArraysIndirect(GL_TRIANGLES, (void*)0);
+  } else {
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*)0);
+  }
+  glBindVertexArray(0);
+}
+
+static void cleanup(void *user_data) {
+  struct CullData *data = (struct CullData*)user_data;
+
+  glDeleteBuffers(1, &data->command);
+  glDeleteBuffers(1, &data->visible);
+  glDeleteBuffers(1, &data->objects);
+  glDeleteBuffers(2, data->mesh_buffers);
+  glDeleteVertexArrays(1, &data->vao);
+  glDeleteProgram(data->draw_program);
+  glDeleteProgram(data->cull_program);
+}
+
+static const struct CullParams params_elements = { 0 };
+static const struct CullParams params_arrays = { 1 };
+
+EXAMPLE_REGISTER(culling, "indirect-culling", init, draw, cleanup, &params_elements)
+EXAMPLE_REGISTER(culling_arrays, "indirect-culling-arrays", init, draw, cleanup, &params_arrays)
@@ -0,0 +1,190 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "example_registry.h"
+#include "matrix.h"
+#include "render_common.h"
+#include "render_graph.h"
+#include "shaders.h"
+#include "trace.h"
+
+static const char *shader_vertex_scene = SHADER_GLSLV(320,
+  uniform mat4 modelviewProjection;
+  out vec4 v_color;
+  void main() {
+    const vec4 colors[3] = vec4[3](
+      vec4(1.0, 0.0, 0.0, 1.0),
+      vec4(0.0, 1.0, 0.0, 1.0),
+      vec4(0.0, 0.0, 1.0, 1.0)
+    );
+    const vec4 verts[3] = vec4[3](
+      vec4(-1.0, -1.0, 0.0, 1.0),
+      vec4( 1.0, -1.0, 0.0, 1.0),
+      vec4( 0.0, 1.0, 0.0, 1.0)
+    );
+    gl_Position = modelviewProjection * verts[gl_VertexID];
+    v_color = colors[gl_VertexID];
+  };
+);
+
+/* Single triangle covering the whole viewport */
+static const char *shader_vertex_fullscreen = SHADER_GLSLV(320,
+  out vec2 v_uv;
+  void main() {
+    vec2 pos = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+    v_uv = pos * 0.5 + 0.5;
+    gl_Position = vec4(pos, 0.0, 1.0);
+  };
+);
+
+static const char *shader_fragment_post = SHADER_GLSLV(320,
+  precision mediump float;
+  uniform sampler2D source;
+  uniform vec2 source_extent;
+  uniform int effect;
+  in vec2 v_uv;
+  out vec4 color_out;
+  void main() {
+    vec4 color = texture(source, v_uv * source_extent);
+    if (effect == 0) {
+      float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+      color_out = vec4(vec3(luma), color.a);
+    } else if (effect == 1) {
+      color_out = vec4(vec3(1.0) - color.rgb, color.a);
+    } else {
+      float dist = distance(v_uv, vec2(0.5));
+      color_out = vec4(color.rgb * smoothstep(0.8, 0.3, dist), color.a);
+    }
+  };
+);
+
+enum post_effect {
+  POST_GRAYSCALE,
+  POST_INVERT,
+  POST_VIGNETTE,
+  POST_EFFECT_COUNT,
+};
+
+struct PostData;
+
+struct PostEffect {
+  struct PostData *data;
+  enum post_effect effect;
+};
+
+struct PostData {
+  GLuint scene_program;
+  GLint u_matrix;
+  GLuint post_program;
+  GLint u_effect;
+  GLint u_source_extent;
+  GLfloat matrix[16];
+  RenderGraph graph;
+  struct PostEffect effects[POST_EFFECT_COUNT];
+};
+
+static void scene_pass(const RenderPass *pass) {
+  TRACE_SCOPE("scene_pass");
+  struct PostData *data = (struct PostData*)pass->user_data;
+
+  glUseProgram(data->scene_program);
+  glUniformMatrix4fv(data->u_matrix, 1, GL_FALSE, data->matrix);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+static void post_pass(const RenderPass *pass) {
+  TRACE_SCOPE("post_pass");
+  struct PostEffect *post = (struct PostEffect*)pass->user_data;
+
+  glUseProgram(post->data->post_program);
+  glUniform1i(post->data->u_effect, post->effect);
+  glUniform2fv(post->data->u_source_extent, 1, pass->input_extent[0]);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+static void init(const RenderContext renderCtx, void **user_data) {
+  static struct PostData data;
+
+  data.scene_program = shader_program_create(shader_vertex_scene, shader_get(SHADER_FRAGMENT_PASSTHROUGH));
+  data.u_matrix = glGetUniformLocation(data.scene_program, "modelviewProjection");
+
+  data.post_program = shader_program_create(shader_vertex_fullscreen, shader_fragment_post);
+  data.u_effect = glGetUniformLocation(data.post_program, "effect");
+  data.u_source_extent = glGetUniformLocation(data.post_program, "source_extent");
+  glUseProgram(data.post_program);
+  glUniform1i(glGetUniformLocation(data.post_program, "source"), 0);
+
+  for (int i = 0; i < POST_EFFECT_COUNT; i++) {
+    data.effects[i].data = &data;
+    data.effects[i].effect = (enum post_effect)i;
+  }
+
+  /* scene -> grayscale -> invert -> vignette: the inverted image reuses the
+   * scene texture, which is dead once grayscale has read it.
+   */
+  RenderGraph *graph = &data.graph;
+  render_graph_init(graph);
+  int scene = render_graph_add_resource(graph, GL_RGBA8, 1.0);
+  int gray = render_graph_add_resource(graph, GL_RGBA8, 1.0);
+  int inverted = render_graph_add_resource(graph, GL_RGBA8, 1.0);
+
+  RenderPass *pass = render_graph_add_pass(graph, "scene", scene_pass, &data);
+  render_pass_write(pass, scene, RENDER_LOAD_CLEAR, RENDER_STORE_KEEP);
+  pass->clear_color[0] = pass->clear_color[1] = pass->clear_color[2] = 0.4;
+
+  pass = render_graph_add_pass(graph, "grayscale", post_pass, &data.effects[POST_GRAYSCALE]);
+  render_pass_read(pass, scene);
+  render_pass_write(pass, gray, RENDER_LOAD_DONT_CARE, RENDER_STORE_KEEP);
+
+  pass = render_graph_add_pass(graph, "invert", post_pass, &data.effects[POST_INVERT]);
+  render_pass_read(pass, gray);
+  render_pass_write(pass, inverted, RENDER_LOAD_DONT_CARE, RENDER_STORE_KEEP);
+
+  pass = render_graph_add_pass(graph, "vignette", post_pass, &data.effects[POST_VIGNETTE]);
+  render_pass_read(pass, inverted);
+  render_pass_write(pass, RENDER_GRAPH_BACKBUFFER, RENDER_LOAD_DONT_CARE, RENDER_STORE_KEEP);
+
+  (*user_data) = (void*)&data;
+}
+
+static void draw(view_rotation_t rotation, void *user_data) {
+  struct PostData *data = (struct PostData*)user_data;
+
+  GLfloat rot[16], scale[16];
+  matrix_make_rotate_z(rot, rotation.x);
+  matrix_make_scale(scale, 0.5, 0.5, 0.5);
+  matrix_mul(data->matrix, rot, scale);
+
+  const render_view_t *view = render_current_view();
+  render_graph_execute(&data->graph, view->framebuffer, view->viewport);
+}
+
+static void cleanup(void *user_data) {
+  struct PostData *data = (struct PostData*)user_data;
+
+  render_graph_destroy(&data->graph);
+  glDeleteProgram(data->scene_program);
+  glDeleteProgram(data->post_program);
+}
+
+EXAMPLE_REGISTER(postprocess, "postprocess", init, draw, cleanup, NULL)
@@ -0,0 +1,263 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "example_registry.h"
+#include "ktx.h"
+#include "matrix.h"
+#include "render_common.h"
+#include "shaders.h"
+#include "texture.h"
+
+/* Streams two mipmapped textures in the background while drawing, one
+ * uncompressed (RGBA8) and one ETC2 compressed. init writes both as KTX
+ * files with every level tinted differently, the streamer reads them on its
+ * thread and each draw pumps at most STREAM_BUDGET bytes to the GPU, so the
+ * quads start blurry and sharpen over the next frames. Run it with
+ * -benchmark to draw (and pump) continuously.
+ */
+
+#define STREAM_SIZE 1024
+#define STREAM_BUDGET (256 * 1024)
+
+static const char *shader_vertex_quad = SHADER_GLSLV(320,
+  uniform mat4 modelviewProjection;
+  out vec2 v_uv;
+  void main() {
+    vec2 uv = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    v_uv = uv;
+    gl_Position = modelviewProjection * vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+  };
+);
+
+static const char *shader_fragment_texture = SHADER_GLSLV(320,
+  precision mediump float;
+  uniform sampler2D image;
+  uniform int ready;
+  in vec2 v_uv;
+  out vec4 color_out;
+  void main() {
+    if (ready == 1) {
+      color_out = texture(image, v_uv);
+    } else {
+      color_out = vec4(0.2, 0.2, 0.2, 1.0);
+    }
+  };
+);
+
+enum stream_kind {
+  STREAM_RGBA8,
+  STREAM_ETC2,
+  STREAM_COUNT,
+};
+
+struct Stream {
+  const char *name;
+  char path[64];
+  StreamedTexture *texture;
+  int finest_level;
+};
+
+struct StreamData {
+  GLuint program;
+  GLint u_matrix;
+  GLint u_ready;
+  TextureStreamer *streamer;
+  struct Stream streams[STREAM_COUNT];
+  int frames;
+};
+
+/* Checkerboard, tinted per level so each newly arrived level shows */
+static void stream_texel(int size, int level, int x, int y, unsigned char *rgb) {
+  static const unsigned char tints[6][3] = {
+    { 255, 64, 64 }, { 64, 255, 64 }, { 64, 64, 255 },
+    { 255, 255, 64 }, { 64, 255, 255 }, { 255, 64, 255 },
+  };
+  static const unsigned char white[3] = { 255, 255, 255 };
+
+  const unsigned char *tint = level == 0 ? white : tints[level % 6];
+  int dark = ((x * 16 / size) + (y * 16 / size)) & 1;
+  for (int c = 0; c < 3; c++) {
+    rgb[c] = dark ? tint[c] / 4 : tint[c];
+  }
+}
+
+/* One solid colour ETC2 RGB block: differential mode with zero deltas and
+ * every pixel on the smallest modifier of table 0.
+ */
+static void stream_etc2_block(const unsigned char *rgb, unsigned char *block) {
+  memset(block, 0, 8);
+  for (int c = 0; c < 3; c++) {
+    block[c] = (unsigned char)((rgb[c] >> 3) << 3);
+  }
+  block[3] = 0x02;  /* diff bit */
+}
+
+static unsigned char *stream_level(enum stream_kind kind, int size, int level, size_t *level_size) {
+  int blocks = (size + 3) / 4;
+  *level_size = kind == STREAM_ETC2 ? (size_t)blocks * blocks * 8 : (size_t)size * size * 4;
+
+  unsigned char *data = malloc(*level_size);
+  if (!data) {
+    fprintf(stderr, "Error: out of memory for texture level %d\n", level);
+    exit(1);
+  }
+
+  if (kind == STREAM_ETC2) {
+    for (int by = 0; by < blocks; by++) {
+      for (int bx = 0; bx < blocks; bx++) {
+        unsigned char rgb[3];
+        stream_texel(size, level, bx * 4, by * 4, rgb);
+        stream_etc2_block(rgb, &data[(by * blocks + bx) * 8]);
+      }
+    }
+  } else {
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++) {
+        unsigned char *pixel = &data[(y * size + x) * 4];
+        stream_texel(size, level, x, y, pixel);
+        pixel[3] = 255;
+      }
+    }
+  }
+  return data;
+}
+
+static void write_stream_file(enum stream_kind kind, const char *path) {
+  const void *level_data[KTX_MAX_LEVELS];
+  size_t level_size[KTX_MAX_LEVELS];
+  int levels = 0;
+
+  for (int size = STREAM_SIZE; size > 0; size >>= 1, levels++) {
+    level_data[levels] = stream_level(kind, size, levels, &level_size[levels]);
+  }
+
+  size_t file_size;
+  unsigned char *file;
+  if (kind == STREAM_ETC2) {
+    file = ktx_build(GL_COMPRESSED_RGB8_ETC2, 0, 0, STREAM_SIZE, STREAM_SIZE,
+                     levels, level_data, level_size, &file_size);
+  } else {
+    file = ktx_build(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, STREAM_SIZE, STREAM_SIZE,
+                     levels, level_data, level_size, &file_size);
+  }
+  FILE *out = fopen(path, "wb");
+  if (!out || fwrite(file, 1, file_size, out) != file_size) {
+    fprintf(stderr, "Error: couldn't write %s\n", path);
+    exit(1);
+  }
+  fclose(out);
+
+  free(file);
+  for (int i = 0; i < levels; i++) {
+    free((void*)level_data[i]);
+  }
+}
+
+static void init(const RenderContext renderCtx, void **user_data) {
+  static struct StreamData data;
+  static const char *names[STREAM_COUNT] = { "RGBA8", "ETC2" };
+
+  data.program = shader_program_create(shader_vertex_quad, shader_fragment_texture);
+  data.u_matrix = glGetUniformLocation(data.program, "modelviewProjection");
+  data.u_ready = glGetUniformLocation(data.program, "ready");
+  glUseProgram(data.program);
+  glUniform1i(glGetUniformLocation(data.program, "image"), 0);
+
+  data.streamer = texture_streamer_create(STREAM_BUDGET);
+  for (int i = 0; i < STREAM_COUNT; i++) {
+    struct Stream *stream = &data.streams[i];
+    stream->name = names[i];
+    strcpy(stream->path, "/tmp/gles-streaming-XXXXXX");
+    int fd = mkstemp(stream->path);
+    if (fd < 0) {
+      fprintf(stderr, "Error: couldn't create a temporary texture file\n");
+      exit(1);
+    }
+    close(fd);
+    write_stream_file((enum stream_kind)i, stream->path);
+
+    stream->texture = texture_stream_ktx(data.streamer, stream->path);
+    stream->finest_level = -1;
+  }
+  data.frames = 0;
+
+  glClearColor(0.4, 0.4, 0.4, 0.0);
+  (*user_data) = (void*)&data;
+}
+
+static void draw(view_rotation_t rotation, void *user_data) {
+  struct StreamData *data = (struct StreamData*)user_data;
+
+  data->frames++;
+  size_t uploaded = texture_streamer_pump(data->streamer);
+
+  GLfloat mat[16], rot[16], scale[16];
+  matrix_make_rotate_z(rot, rotation.x);
+  matrix_make_scale(scale, 0.45, 0.45, 0.45);
+  matrix_mul(mat, rot, scale);
+
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glUseProgram(data->program);
+  glActiveTexture(GL_TEXTURE0);
+
+  /* Uncompressed on the left, ETC2 on the right */
+  for (int i = 0; i < STREAM_COUNT; i++) {
+    struct Stream *stream = &data->streams[i];
+    StreamedTexture *texture = stream->texture;
+
+    int ready = texture->state == TEXTURE_PARTIAL || texture->state == TEXTURE_COMPLETE;
+    if (uploaded > 0 && ready && texture->finest_level != stream->finest_level) {
+      stream->finest_level = texture->finest_level;
+      printf("Frame %d: %s level %d ready (%dx%d)\n", data->frames, stream->name, texture->finest_level,
+             texture->width >> texture->finest_level, texture->height >> texture->finest_level);
+    }
+
+    mat[12] = i == STREAM_RGBA8 ? -0.5f : 0.5f;
+    glUniformMatrix4fv(data->u_matrix, 1, GL_FALSE, mat);
+    glUniform1i(data->u_ready, ready);
+    glBindTexture(GL_TEXTURE_2D, ready ? texture->id : 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+}
+
+static void cleanup(void *user_data) {
+  struct StreamData *data = (struct StreamData*)user_data;
+
+  for (int i = 0; i < STREAM_COUNT; i++) {
+    if (data->streams[i].texture->state == TEXTURE_FAILED) {
+      printf("Streaming the %s texture failed\n", data->streams[i].name);
+    }
+  }
+  texture_streamer_destroy(data->streamer);
+  for (int i = 0; i < STREAM_COUNT; i++) {
+    unlink(data->streams[i].path);
+  }
+  glDeleteProgram(data->program);
+}
+
+EXAMPLE_REGISTER(streaming, "texture-streaming", init, draw, cleanup, NULL)
@@ -21,6 +21,7 @@
  * SOFTWARE.
  */
 
+#include "example_registry.h"
 #include "matrix.h"
 #include "render_common.h"
 #include "shaders.h"
@@ -51,34 +52,45 @@ static const char *shader_vertex = SHADER_GLSLV(320,
   };
 );
 
+struct TriangleParams {
+  int with_rotation;
+};
+
+struct ProgramData {
+  GLuint program;
+  GLint u_matrix;
+  int with_rotation;
+};
+
 static void init(const RenderContext renderCtx, void **user_data) {
-  GLuint program = shader_program_create(shader_vertex, shader_get(SHADER_FRAGMENT_PASSTHROUGH));
-  glUseProgram(program);
+  static struct ProgramData data;
+  const struct TriangleParams *params = renderCtx.callbacks.params;
 
-#ifdef WITH_ROTATION
-  static GLuint u_matrix;
-  u_matrix = glGetUniformLocation(program, "modelviewProjection");
-  GLuint u_hasMVP = glGetUniformLocation(program, "hasMVP");
-  glUniform1i(u_hasMVP, 1);
+  data.program = shader_program_create(shader_vertex, shader_get(SHADER_FRAGMENT_PASSTHROUGH));
+  data.with_rotation = params->with_rotation;
+  glUseProgram(data.program);
 
-  (*user_data) = (void*)&u_matrix;
-#endif
+  GLuint u_hasMVP = glGetUniformLocation(data.program, "hasMVP");
+  glUniform1i(u_hasMVP, data.with_rotation);
+  data.u_matrix = glGetUniformLocation(data.program, "modelviewProjection");
 
   glClearColor(0.4, 0.4, 0.4, 0.0);
+  (*user_data) = (void*)&data;
 }
 
 static void draw(view_rotation_t rotation, void *user_data) {
-#ifdef WITH_ROTATION
-  GLfloat mat[16], rot[16], scale[16];
-  GLuint u_matrix = *((GLuint*)user_data);
+  struct ProgramData *data = (struct ProgramData*)user_data;
+
+  if (data->with_rotation) {
+    GLfloat mat[16], rot[16], scale[16];
 
-  /* Set modelview/projection matrix */
-  matrix_make_rotate_z(rot, rotation.x);
-  matrix_make_scale(scale, 0.5, 0.5, 0.5);
-  matrix_mul(mat, rot, scale);
+    /* Set modelview/projection matrix */
+    matrix_make_rotate_z(rot, rotation.x);
+    matrix_make_scale(scale, 0.5, 0.5, 0.5);
+    matrix_mul(mat, rot, scale);
 
-  glUniformMatrix4fv(u_matrix, 1, GL_FALSE, mat);
-#endif
+    glUniformMatrix4fv(data->u_matrix, 1, GL_FALSE, mat);
+  }
 
   glClearColor(0.4, 0.4, 0.4, 0.0);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -86,10 +98,14 @@ static void draw(view_rotation_t rotation, void *user_data) {
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 3);
 }
 
-int main(int argc, char *argv[]) {
-  RenderCallbacks callbacks;
-  callbacks.initializer = init;
-  callbacks.draw = draw;
+static void cleanup(void *user_data) {
+  struct ProgramData *data = (struct ProgramData*)user_data;
 
-  return render_main(argc, argv, callbacks);
+  glDeleteProgram(data->program);
 }
+
+static const struct TriangleParams params_static = { 0 };
+static const struct TriangleParams params_rotation = { 1 };
+
+EXAMPLE_REGISTER(no_vao, "triangle-no-vao", init, draw, cleanup, &params_static)
+EXAMPLE_REGISTER(no_vao_rot, "triangle-no-vao-rot", init, draw, cleanup, &params_rotation)
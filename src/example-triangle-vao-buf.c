@@ -21,18 +21,32 @@
  * SOFTWARE.
  */
 
+#include "example_registry.h"
 #include "matrix.h"
 #include "render_common.h"
+#include "scene.h"
 #include "shaders.h"
+#include "trace.h"
+
+struct TriangleParams {
+  int ptr_data;  /* source the vertices from client memory instead of a VBO */
+};
 
 struct ProgramData {
   GLint attr_pos;
   GLint attr_color;
   GLint u_matrix;
   GLuint program;
+  GLuint vao;
+  GLuint vbo;
+  SceneGraph scene;
+  int node_view;
+  int node_triangle;
+  GLfloat last_rotation;
 };
 
 static void config_shaders(GLuint program, struct ProgramData *data) {
+  TRACE_SCOPE("config_shaders");
   data->attr_pos = 0;
   data->attr_color = 1;
 
@@ -43,7 +57,8 @@ static void config_shaders(GLuint program, struct ProgramData *data) {
   data->u_matrix = glGetUniformLocation(program, "modelviewProjection");
 }
 
-static void create_vao(struct ProgramData data) {
+static void create_vao(struct ProgramData *data, int ptr_data) {
+  TRACE_SCOPE("create_vao");
   static const GLfloat buffer_data[3][5] = {
     { -1, -1, 1, 0, 0 }, /* position (2 float), color (3 float) */
     {  1, -1, 0, 1, 0 },
@@ -51,35 +66,44 @@ static void create_vao(struct ProgramData data) {
   };
 
   GLvoid *offset_ptr;
-#ifdef WITH_PTR_DATA
-  offset_ptr = (GLvoid*)&buffer_data;
-#else
-  GLuint VAO_id, VBO_id;
-
-  glGenVertexArrays(1, &VAO_id);
-  glBindVertexArray(VAO_id);
-
-  glGenBuffers(1, &VBO_id);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO_id);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(buffer_data), buffer_data, GL_STATIC_DRAW);
-  offset_ptr = NULL;
-#endif
-
-  glVertexAttribPointer(data.attr_pos, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 5, offset_ptr); /* position */
-  glVertexAttribPointer(data.attr_color, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 5, (void*) offset_ptr + (sizeof(float) * 2)); /* color */
-
-  glEnableVertexAttribArray(data.attr_pos);
-  glEnableVertexAttribArray(data.attr_color);
+  data->vao = 0;
+  data->vbo = 0;
+  if (ptr_data) {
+    offset_ptr = (GLvoid*)&buffer_data;
+  } else {
+    glGenVertexArrays(1, &data->vao);
+    glBindVertexArray(data->vao);
+
+    glGenBuffers(1, &data->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, data->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(buffer_data), buffer_data, GL_STATIC_DRAW);
+    offset_ptr = NULL;
+  }
+
+  glVertexAttribPointer(data->attr_pos, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 5, offset_ptr); /* position */
+  glVertexAttribPointer(data->attr_color, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 5, (void*) offset_ptr + (sizeof(float) * 2)); /* color */
+
+  glEnableVertexAttribArray(data->attr_pos);
+  glEnableVertexAttribArray(data->attr_color);
 }
 
 static void init(const RenderContext renderCtx, void **user_data) {
   static struct ProgramData data;
+  const struct TriangleParams *params = renderCtx.callbacks.params;
 
   glClearColor(0.4, 0.4, 0.4, 0.0);
   data.program = shader_program_create(shader_get(SHADER_VERTEX_MVP),
                                        shader_get(SHADER_FRAGMENT_PASSTHROUGH));
   config_shaders(data.program, &data);
-  create_vao(data);
+  create_vao(&data, params->ptr_data);
+
+  /* The triangle's scale never changes, only the view rotation above it */
+  GLfloat scale[16];
+  matrix_make_scale(scale, 0.5, 0.5, 0.5);
+  scene_graph_init(&data.scene, 2);
+  data.node_view = scene_graph_add_node(&data.scene, SCENE_NO_PARENT, NULL);
+  data.node_triangle = scene_graph_add_node(&data.scene, data.node_view, scale);
+  data.last_rotation = 0.0;
 
   glUseProgram(data.program);
   (*user_data) = (void*)&data;
@@ -88,14 +112,17 @@ static void init(const RenderContext renderCtx, void **user_data) {
 static void draw(view_rotation_t rotation, void *user_data) {
   struct ProgramData *data = (struct ProgramData*)user_data;
 
-  GLfloat mat[16], rot[16], scale[16];
-
-  /* Set modelview/projection matrix */
-  matrix_make_rotate_z(rot, rotation.x);
-  matrix_make_scale(scale, 0.5, 0.5, 0.5);
-  matrix_mul(mat, rot, scale);
+  if (rotation.x != data->last_rotation) {
+    GLfloat rot[16];
+    matrix_make_rotate_z(rot, rotation.x);
+    scene_graph_set_local(&data->scene, data->node_view, rot);
+    data->last_rotation = rotation.x;
+  }
 
-  glUniformMatrix4fv(data->u_matrix, 1, GL_FALSE, mat);
+  /* Set modelview/projection matrix, only when the transforms changed */
+  if (scene_graph_update(&data->scene) > 0) {
+    glUniformMatrix4fv(data->u_matrix, 1, GL_FALSE, scene_graph_world(&data->scene, data->node_triangle));
+  }
 
   glClearColor(0.4, 0.4, 0.4, 0.0);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -103,10 +130,17 @@ static void draw(view_rotation_t rotation, void *user_data) {
   glDrawArrays(GL_TRIANGLES, 0, 3);
 }
 
-int main(int argc, char *argv[]) {
-  RenderCallbacks callbacks;
-  callbacks.initializer = init;
-  callbacks.draw = draw;
+static void cleanup(void *user_data) {
+  struct ProgramData *data = (struct ProgramData*)user_data;
 
-  return render_main(argc, argv, callbacks);
+  scene_graph_destroy(&data->scene);
+  glDeleteBuffers(1, &data->vbo);
+  glDeleteVertexArrays(1, &data->vao);
+  glDeleteProgram(data->program);
 }
+
+static const struct TriangleParams params_buffer = { 0 };
+static const struct TriangleParams params_pointer = { 1 };
+
+EXAMPLE_REGISTER(vao_buf, "triangle-vao-buf", init, draw, cleanup, &params_buffer)
+EXAMPLE_REGISTER(vao_ptr, "triangle-vao-ptr", init, draw, cleanup, &params_pointer)
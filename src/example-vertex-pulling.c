@@ -0,0 +1,408 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "example_registry.h"
+#include "geometry.h"
+#include "matrix.h"
+#include "render_common.h"
+#include "shaders.h"
+#include "trace.h"
+
+/* Vertex pulling: the vertex shader fetches vertices itself from shader
+ * storage buffers using gl_VertexID/gl_InstanceID, compared against classic
+ * attribute fetch. Both paths draw indexed, so post-transform vertex reuse
+ * is the same and only the fetch differs. Pulling can merge many meshes
+ * into one instanced draw without any VAO switches.
+ *
+ * The vertex-pulling-bench variant first sweeps mesh sizes, vertex layouts
+ * and mesh counts over both fetch paths and prints a table.
+ */
+
+#define MAX_MESHES 16
+
+static const char *shader_vertex_attrib = SHADER_GLSLV(320,
+  uniform mat4 modelviewProjection;
+  uniform int mesh_columns;
+  uniform int mesh_index;
+  layout(location = 0) in vec2 pos;
+  layout(location = 1) in vec4 color;
+  out vec4 v_color;
+  vec2 place(vec2 p, int mesh) {
+    vec2 cell = vec2(float(mesh % mesh_columns), float(mesh / mesh_columns));
+    return (p * 0.5 + 0.5 + cell) * 2.0 / float(mesh_columns) - 1.0;
+  }
+  void main() {
+    gl_Position = modelviewProjection * vec4(place(pos, mesh_index), 0.0, 1.0);
+    v_color = color;
+  };
+);
+
+static const char *shader_vertex_pulling = SHADER_GLSLV(320,
+  uniform mat4 modelviewProjection;
+  uniform int mesh_columns;
+  uniform int vertex_count;
+  uniform int interleaved;
+  layout(std430, binding = 0) readonly buffer Interleaved { float vertex_data[]; };
+  layout(std430, binding = 1) readonly buffer Positions { vec2 positions[]; };
+  layout(std430, binding = 2) readonly buffer Colors { vec4 colors[]; };
+  out vec4 v_color;
+  vec2 place(vec2 p, int mesh) {
+    vec2 cell = vec2(float(mesh % mesh_columns), float(mesh / mesh_columns));
+    return (p * 0.5 + 0.5 + cell) * 2.0 / float(mesh_columns) - 1.0;
+  }
+  void main() {
+    /* In an indexed draw gl_VertexID already is the index */
+    int index = gl_VertexID + gl_InstanceID * vertex_count;
+    vec2 pos;
+    vec4 color;
+    if (interleaved == 1) {
+      int base = index * 6;
+      pos = vec2(vertex_data[base], vertex_data[base + 1]);
+      color = vec4(vertex_data[base + 2], vertex_data[base + 3], vertex_data[base + 4], vertex_data[base + 5]);
+    } else {
+      pos = positions[index];
+      color = colors[index];
+    }
+    gl_Position = modelviewProjection * vec4(place(pos, gl_InstanceID), 0.0, 1.0);
+    v_color = color;
+  };
+);
+
+enum vertex_layout {
+  LAYOUT_INTERLEAVED,  /* x y r g b a */
+  LAYOUT_SEPARATE,     /* x y | r g b a */
+};
+
+enum vertex_fetch {
+  FETCH_ATTRIB,
+  FETCH_PULLING,
+};
+
+struct Programs {
+  GLuint attrib;
+  GLint attrib_matrix;
+  GLint attrib_columns;
+  GLint attrib_mesh;
+
+  GLuint pulling;
+  GLint pulling_matrix;
+  GLint pulling_columns;
+  GLint pulling_vertex_count;
+  GLint pulling_interleaved;
+  int pulling_supported;
+};
+
+struct MeshSet {
+  enum vertex_layout layout;
+  int mesh_count;
+  int mesh_columns;
+  int vertex_count;
+  int index_count;
+
+  /* attribute fetch: one VAO per mesh */
+  GLuint vaos[MAX_MESHES];
+  GLuint vertex_buffers[MAX_MESHES][2];
+  GLuint index_buffers[MAX_MESHES];
+
+  /* pulling: every mesh in the same storage buffers, the VAO only holds the indices */
+  GLuint pulling_vao;
+  GLuint pulling_indices;
+  GLuint storage[3];
+};
+
+static void mesh_set_create(struct MeshSet *set, int quads, enum vertex_layout layout, int mesh_count) {
+  TRACE_SCOPE("mesh_set_create");
+  Geometry grid;
+
+  memset(set, 0, sizeof(*set));
+  set->layout = layout;
+  set->mesh_count = mesh_count;
+  set->mesh_columns = 1;
+  while (set->mesh_columns * set->mesh_columns < mesh_count) {
+    set->mesh_columns++;
+  }
+  geometry_make_grid(&grid, quads, 1.0);
+  set->vertex_count = grid.vertex_count;
+  set->index_count = grid.index_count;
+
+  /* The grid is flat, only x and y are needed */
+  int count = set->vertex_count;
+  GLfloat *positions = malloc(sizeof(GLfloat) * 2 * count);
+  GLfloat *interleaved = malloc(sizeof(GLfloat) * 6 * count);
+  GLfloat *colors = grid.colors;
+  GLuint *indices = grid.indices;
+  for (int v = 0; v < count; v++) {
+    memcpy(&positions[v * 2], &grid.positions[v * 3], sizeof(GLfloat) * 2);
+    memcpy(&interleaved[v * 6], &positions[v * 2], sizeof(GLfloat) * 2);
+    memcpy(&interleaved[v * 6 + 2], &colors[v * 4], sizeof(GLfloat) * 4);
+  }
+
+  glGenVertexArrays(mesh_count, set->vaos);
+  glGenBuffers(mesh_count, set->index_buffers);
+  for (int m = 0; m < mesh_count; m++) {
+    glBindVertexArray(set->vaos[m]);
+    glGenBuffers(2, set->vertex_buffers[m]);
+
+    if (layout == LAYOUT_INTERLEAVED) {
+      glBindBuffer(GL_ARRAY_BUFFER, set->vertex_buffers[m][0]);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * count, interleaved, GL_STATIC_DRAW);
+      glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 6, (void*)0);
+      glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 6, (void*)(sizeof(GLfloat) * 2));
+    } else {
+      glBindBuffer(GL_ARRAY_BUFFER, set->vertex_buffers[m][0]);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 2 * count, positions, GL_STATIC_DRAW);
+      glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+      glBindBuffer(GL_ARRAY_BUFFER, set->vertex_buffers[m][1]);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 4 * count, colors, GL_STATIC_DRAW);
+      glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, set->index_buffers[m]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * set->index_count, indices, GL_STATIC_DRAW);
+  }
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  /* Pulling path: indices once, vertices of every mesh back to back */
+  glGenVertexArrays(1, &set->pulling_vao);
+  glBindVertexArray(set->pulling_vao);
+  glGenBuffers(1, &set->pulling_indices);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, set->pulling_indices);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * set->index_count, indices, GL_STATIC_DRAW);
+  glBindVertexArray(0);
+
+  glGenBuffers(3, set->storage);
+  if (layout == LAYOUT_INTERLEAVED) {
+    size_t size = sizeof(GLfloat) * 6 * count;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, set->storage[0]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size * mesh_count, NULL, GL_STATIC_DRAW);
+    for (int m = 0; m < mesh_count; m++) {
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, size * m, size, interleaved);
+    }
+  } else {
+    size_t size = sizeof(GLfloat) * 2 * count;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, set->storage[1]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size * mesh_count, NULL, GL_STATIC_DRAW);
+    for (int m = 0; m < mesh_count; m++) {
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, size * m, size, positions);
+    }
+
+    size = sizeof(GLfloat) * 4 * count;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, set->storage[2]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size * mesh_count, NULL, GL_STATIC_DRAW);
+    for (int m = 0; m < mesh_count; m++) {
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, size * m, size, colors);
+    }
+  }
+
+  /* Unused bindings still need a buffer behind them */
+  for (int i = 0; i < 3; i++) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, set->storage[i]);
+    GLint size = 0;
+    glGetBufferParameteriv(GL_SHADER_STORAGE_BUFFER, GL_BUFFER_SIZE, &size);
+    if (size == 0) {
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLfloat) * 4, NULL, GL_STATIC_DRAW);
+    }
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  free(interleaved);
+  free(positions);
+  geometry_destroy(&grid);
+}
+
+static void mesh_set_destroy(struct MeshSet *set) {
+  for (int m = 0; m < set->mesh_count; m++) {
+    glDeleteBuffers(2, set->vertex_buffers[m]);
+  }
+  glDeleteBuffers(set->mesh_count, set->index_buffers);
+  glDeleteVertexArrays(set->mesh_count, set->vaos);
+  glDeleteBuffers(3, set->storage);
+  glDeleteBuffers(1, &set->pulling_indices);
+  glDeleteVertexArrays(1, &set->pulling_vao);
+}
+
+static void mesh_set_draw(const struct MeshSet *set, const struct Programs *programs,
+                          enum vertex_fetch fetch, const GLfloat *matrix) {
+  if (fetch == FETCH_ATTRIB) {
+    glUseProgram(programs->attrib);
+    glUniformMatrix4fv(programs->attrib_matrix, 1, GL_FALSE, matrix);
+    glUniform1i(programs->attrib_columns, set->mesh_columns);
+    for (int m = 0; m < set->mesh_count; m++) {
+      glBindVertexArray(set->vaos[m]);
+      glUniform1i(programs->attrib_mesh, m);
+      glDrawElements(GL_TRIANGLES, set->index_count, GL_UNSIGNED_INT, (void*)0);
+    }
+  } else {
+    glUseProgram(programs->pulling);
+    glUniformMatrix4fv(programs->pulling_matrix, 1, GL_FALSE, matrix);
+    glUniform1i(programs->pulling_columns, set->mesh_columns);
+    glUniform1i(programs->pulling_vertex_count, set->vertex_count);
+    glUniform1i(programs->pulling_interleaved, set->layout == LAYOUT_INTERLEAVED);
+    for (int i = 0; i < 3; i++) {
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, set->storage[i]);
+    }
+    glBindVertexArray(set->pulling_vao);
+    glDrawElementsInstanced(GL_TRIANGLES, set->index_count, GL_UNSIGNED_INT, (void*)0, set->mesh_count);
+  }
+  glBindVertexArray(0);
+}
+
+static void programs_create(struct Programs *programs) {
+  programs->attrib = shader_program_create(shader_vertex_attrib, shader_get(SHADER_FRAGMENT_PASSTHROUGH));
+  programs->attrib_matrix = glGetUniformLocation(programs->attrib, "modelviewProjection");
+  programs->attrib_columns = glGetUniformLocation(programs->attrib, "mesh_columns");
+  programs->attrib_mesh = glGetUniformLocation(programs->attrib, "mesh_index");
+
+  /* GLES 3.1 allows zero storage blocks in vertex shaders */
+  GLint vertex_blocks = 0;
+  glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertex_blocks);
+  programs->pulling_supported = vertex_blocks >= 3;
+  if (!programs->pulling_supported) {
+    printf("Vertex pulling unavailable: only %d vertex shader storage blocks\n", vertex_blocks);
+    return;
+  }
+
+  programs->pulling = shader_program_create(shader_vertex_pulling, shader_get(SHADER_FRAGMENT_PASSTHROUGH));
+  programs->pulling_matrix = glGetUniformLocation(programs->pulling, "modelviewProjection");
+  programs->pulling_columns = glGetUniformLocation(programs->pulling, "mesh_columns");
+  programs->pulling_vertex_count = glGetUniformLocation(programs->pulling, "vertex_count");
+  programs->pulling_interleaved = glGetUniformLocation(programs->pulling, "interleaved");
+}
+
+struct BenchFrame {
+  const struct MeshSet *set;
+  const struct Programs *programs;
+  enum vertex_fetch fetch;
+  const GLfloat *matrix;
+};
+
+static void bench_frame(void *user_data) {
+  const struct BenchFrame *frame = (const struct BenchFrame*)user_data;
+  glClear(GL_COLOR_BUFFER_BIT);
+  mesh_set_draw(frame->set, frame->programs, frame->fetch, frame->matrix);
+}
+
+static void benchmark(const struct Programs *programs) {
+  TRACE_SCOPE("benchmark");
+  static const int grid_sizes[] = { 8, 64, 256 };
+  static const int mesh_counts[] = { 1, MAX_MESHES };
+  static const char *layout_names[] = { "interleaved", "separate" };
+  static const char *fetch_names[] = { "attrib", "pulling" };
+  const int iterations = 10;
+  const int repetitions = 3;
+
+  GLfloat identity[16];
+  matrix_make_identity(identity);
+
+  BenchTarget target;
+  bench_target_init(&target, 256, 256);
+
+  printf("%8s %7s %12s %8s %12s %10s\n", "vertices", "meshes", "layout", "fetch", "ms/frame", "Mtri/s");
+  for (size_t g = 0; g < sizeof(grid_sizes) / sizeof(grid_sizes[0]); g++) {
+    for (size_t c = 0; c < sizeof(mesh_counts) / sizeof(mesh_counts[0]); c++) {
+      for (int layout = LAYOUT_INTERLEAVED; layout <= LAYOUT_SEPARATE; layout++) {
+        struct MeshSet set;
+        mesh_set_create(&set, grid_sizes[g], (enum vertex_layout)layout, mesh_counts[c]);
+
+        for (int fetch = FETCH_ATTRIB; fetch <= FETCH_PULLING; fetch++) {
+          if (fetch == FETCH_PULLING && !programs->pulling_supported) {
+            continue;
+          }
+
+          struct BenchFrame frame = { &set, programs, (enum vertex_fetch)fetch, identity };
+          double frame_ms = bench_gpu_time_ms(bench_frame, &frame, iterations, repetitions);
+          double triangles = (double)set.index_count / 3 * set.mesh_count;
+
+          printf("%8d %7d %12s %8s %12.3f %10.2f\n", set.vertex_count, set.mesh_count,
+                 layout_names[layout], fetch_names[fetch], frame_ms, triangles / frame_ms / 1e3);
+        }
+
+        mesh_set_destroy(&set);
+      }
+    }
+  }
+
+  bench_target_destroy(&target);
+}
+
+struct PullingParams {
+  int benchmark;
+};
+
+struct ExampleData {
+  struct Programs programs;
+  struct MeshSet meshes;
+  enum vertex_fetch fetch;
+};
+
+static void init(const RenderContext renderCtx, void **user_data) {
+  static struct ExampleData data;
+  const struct PullingParams *params = renderCtx.callbacks.params;
+
+  programs_create(&data.programs);
+
+  if (params->benchmark) {
+    benchmark(&data.programs);
+    glViewport(0, 0, renderCtx.window_size.width, renderCtx.window_size.height);
+  }
+
+  data.fetch = data.programs.pulling_supported ? FETCH_PULLING : FETCH_ATTRIB;
+  mesh_set_create(&data.meshes, 16, LAYOUT_INTERLEAVED, 4);
+
+  glClearColor(0.4, 0.4, 0.4, 0.0);
+  (*user_data) = (void*)&data;
+}
+
+static void draw(view_rotation_t rotation, void *user_data) {
+  struct ExampleData *data = (struct ExampleData*)user_data;
+
+  GLfloat mat[16], rot[16], scale[16];
+  matrix_make_rotate_z(rot, rotation.x);
+  matrix_make_scale(scale, 0.7, 0.7, 0.7);
+  matrix_mul(mat, rot, scale);
+
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  mesh_set_draw(&data->meshes, &data->programs, data->fetch, mat);
+}
+
+static void cleanup(void *user_data) {
+  struct ExampleData *data = (struct ExampleData*)user_data;
+
+  mesh_set_destroy(&data->meshes);
+  glDeleteProgram(data->programs.attrib);
+  glDeleteProgram(data->programs.pulling);
+}
+
+static const struct PullingParams params_default = { 0 };
+static const struct PullingParams params_benchmark = { 1 };
+
+EXAMPLE_REGISTER(pulling, "vertex-pulling", init, draw, cleanup, &params_default)
+EXAMPLE_REGISTER(pulling_bench, "vertex-pulling-bench", init, draw, cleanup, &params_benchmark)
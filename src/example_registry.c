@@ -0,0 +1,65 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "example_registry.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static ExampleDesc examples[EXAMPLE_MAX];
+static int examples_count = 0;
+
+void example_register(const char *name, RenderCallbacks callbacks) {
+  if (examples_count == EXAMPLE_MAX) {
+    fprintf(stderr, "Error: too many examples, can't register %s\n", name);
+    exit(1);
+  }
+  if (example_find(name)) {
+    fprintf(stderr, "Error: example %s registered twice\n", name);
+    exit(1);
+  }
+
+  examples[examples_count].name = name;
+  examples[examples_count].callbacks = callbacks;
+  examples_count++;
+}
+
+int example_count(void) {
+  return examples_count;
+}
+
+const ExampleDesc *example_get(int index) {
+  assert(index >= 0 && index < examples_count);
+  return &examples[index];
+}
+
+const ExampleDesc *example_find(const char *name) {
+  for (int i = 0; i < examples_count; i++) {
+    if (strcmp(examples[i].name, name) == 0) {
+      return &examples[i];
+    }
+  }
+  return NULL;
+}
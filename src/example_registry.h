@@ -0,0 +1,51 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EXAMPLE_REGISTRY_H
+#define EXAMPLE_REGISTRY_H
+
+#include "render_common.h"
+
+#define EXAMPLE_MAX 64
+
+typedef struct {
+  const char *name;
+  RenderCallbacks callbacks;
+} ExampleDesc;
+
+void example_register(const char *name, RenderCallbacks callbacks);
+int example_count(void);
+const ExampleDesc *example_get(int index);
+const ExampleDesc *example_find(const char *name);
+
+/* Registers an example variant before main runs. ID only has to be unique
+ * within the file; PARAMS is handed back through RenderCallbacks.params.
+ */
+#define EXAMPLE_REGISTER(ID, NAME, INIT, DRAW, CLEANUP, PARAMS)          \
+  static void example_register_##ID(void) __attribute__((constructor)); \
+  static void example_register_##ID(void) {                             \
+    RenderCallbacks callbacks = { INIT, DRAW, CLEANUP, PARAMS };        \
+    example_register(NAME, callbacks);                                  \
+  }
+
+#endif
@@ -0,0 +1,161 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "frame_pacing.h"
+
+uint64_t frame_pacer_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void frame_pacer_init(FramePacer *pacer, int max_frames_in_flight, int report_latency) {
+  memset(pacer, 0, sizeof(*pacer));
+  if (max_frames_in_flight > FRAME_PACER_MAX_FRAMES) {
+    max_frames_in_flight = FRAME_PACER_MAX_FRAMES;
+  }
+  pacer->max_frames_in_flight = max_frames_in_flight > 0 ? max_frames_in_flight : 0;
+  pacer->report_latency = report_latency;
+}
+
+static int frame_pacer_enabled(const FramePacer *pacer) {
+  return pacer->max_frames_in_flight > 0 || pacer->report_latency;
+}
+
+static void frame_pacer_add_latency(FramePacer *pacer, uint64_t latency) {
+  if (pacer->latency_count == 0 || latency < pacer->latency_min) {
+    pacer->latency_min = latency;
+  }
+  if (latency > pacer->latency_max) {
+    pacer->latency_max = latency;
+  }
+  pacer->latency_total += latency;
+  pacer->latency_count++;
+}
+
+static void frame_pacer_retire(FramePacer *pacer) {
+  frame_record_t *frame = &pacer->frames[pacer->head];
+
+  glDeleteSync(frame->fence);
+  frame->fence = 0;
+  pacer->head = (pacer->head + 1) % FRAME_PACER_MAX_FRAMES;
+  pacer->count--;
+}
+
+/* Returns non-zero once the fence has signaled */
+static int frame_pacer_poll(GLsync fence, GLuint64 timeout) {
+  GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+  if (result == GL_WAIT_FAILED) {
+    fprintf(stderr, "Error: glClientWaitSync failed\n");
+    return 1;  /* don't spin on a broken fence */
+  }
+  return result != GL_TIMEOUT_EXPIRED;
+}
+
+static int frame_pacer_poll_oldest(FramePacer *pacer, GLuint64 timeout) {
+  return frame_pacer_poll(pacer->frames[pacer->head].fence, timeout);
+}
+
+void frame_pacer_destroy(FramePacer *pacer) {
+  while (pacer->count > 0) {
+    while (!frame_pacer_poll_oldest(pacer, 1000000000ull)) {
+      ;
+    }
+    frame_pacer_retire(pacer);
+  }
+}
+
+void frame_pacer_input(FramePacer *pacer, uint64_t received_ns) {
+  if (pacer->pending_count < FRAME_PACER_MAX_INPUTS) {
+    pacer->pending_inputs[pacer->pending_count++] = received_ns;
+  }
+}
+
+void frame_pacer_begin_frame(FramePacer *pacer) {
+  if (!frame_pacer_enabled(pacer)) {
+    return;
+  }
+
+  /* Collect whatever has already finished without blocking */
+  while (pacer->count > 0 && frame_pacer_poll_oldest(pacer, 0)) {
+    frame_pacer_retire(pacer);
+  }
+
+  /* The ring is the hard limit even when only measuring latency */
+  int limit = pacer->max_frames_in_flight ? pacer->max_frames_in_flight : FRAME_PACER_MAX_FRAMES;
+  while (pacer->count >= limit) {
+    while (!frame_pacer_poll_oldest(pacer, 1000000000ull)) {
+      ;
+    }
+    frame_pacer_retire(pacer);
+  }
+}
+
+void frame_pacer_end_frame(FramePacer *pacer) {
+  if (!frame_pacer_enabled(pacer)) {
+    return;
+  }
+  assert(pacer->count < FRAME_PACER_MAX_FRAMES);
+
+  int tail = (pacer->head + pacer->count) % FRAME_PACER_MAX_FRAMES;
+  GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  pacer->frames[tail].fence = fence;
+  pacer->count++;
+
+  /* Timestamp the completion right away: the fences in the ring are only
+   * polled at the next begin_frame, which in the event driven loop can be
+   * after an arbitrary idle wait.
+   */
+  if (pacer->report_latency && pacer->pending_count > 0) {
+    while (!frame_pacer_poll(fence, 1000000000ull)) {
+      ;
+    }
+    uint64_t now = frame_pacer_now_ns();
+    for (int i = 0; i < pacer->pending_count; i++) {
+      frame_pacer_add_latency(pacer, now - pacer->pending_inputs[i]);
+    }
+  }
+  pacer->pending_count = 0;
+}
+
+void frame_pacer_report(const FramePacer *pacer) {
+  if (!pacer->report_latency) {
+    return;
+  }
+
+  if (pacer->latency_count == 0) {
+    printf("Input latency: no input events measured\n");
+    return;
+  }
+
+  printf("Input latency over %llu events: min %.2f ms, avg %.2f ms, max %.2f ms\n",
+         (unsigned long long)pacer->latency_count,
+         pacer->latency_min / 1e6,
+         (double)pacer->latency_total / pacer->latency_count / 1e6,
+         pacer->latency_max / 1e6);
+}
@@ -0,0 +1,72 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <stdint.h>
+#include <GLES3/gl31.h>
+
+#define FRAME_PACER_MAX_FRAMES 8
+#define FRAME_PACER_MAX_INPUTS 64
+
+typedef struct {
+  GLsync fence;
+} frame_record_t;
+
+/* Keeps track of the frames queued on the GPU with fence syncs. It can cap
+ * the number of frames in flight and measures input-to-completion latency:
+ * the time from receiving each input event until the frame which first
+ * showed its effect has finished on the GPU. Measuring waits for such frames right
+ * after they are submitted, so it costs their CPU/GPU overlap.
+ */
+typedef struct {
+  int max_frames_in_flight;  /* 0 means let the driver decide */
+  int report_latency;
+
+  frame_record_t frames[FRAME_PACER_MAX_FRAMES];
+  int head;
+  int count;
+  uint64_t pending_inputs[FRAME_PACER_MAX_INPUTS];
+  int pending_count;
+
+  uint64_t latency_count;
+  uint64_t latency_total;
+  uint64_t latency_min;
+  uint64_t latency_max;
+} FramePacer;
+
+uint64_t frame_pacer_now_ns(void);
+
+void frame_pacer_init(FramePacer *pacer, int max_frames_in_flight, int report_latency);
+void frame_pacer_destroy(FramePacer *pacer);
+
+/* received_ns is when the event was taken off the queue, on the
+ * frame_pacer_now_ns() clock.
+ */
+void frame_pacer_input(FramePacer *pacer, uint64_t received_ns);
+void frame_pacer_begin_frame(FramePacer *pacer);
+void frame_pacer_end_frame(FramePacer *pacer);
+void frame_pacer_report(const FramePacer *pacer);
+
+#endif /* FRAME_PACING_H */
@@ -0,0 +1,137 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "geometry.h"
+
+static void geometry_alloc(Geometry *geometry, int vertex_count, int index_count) {
+  memset(geometry, 0, sizeof(*geometry));
+  geometry->vertex_count = vertex_count;
+  geometry->index_count = index_count;
+  geometry->positions = malloc(sizeof(GLfloat) * 3 * vertex_count);
+  geometry->colors = malloc(sizeof(GLfloat) * 4 * vertex_count);
+  geometry->indices = malloc(sizeof(GLuint) * index_count);
+
+  if (!geometry->positions || !geometry->colors || !geometry->indices) {
+    fprintf(stderr, "Error: out of memory for %d vertices\n", vertex_count);
+    exit(1);
+  }
+}
+
+static void geometry_set_vertex(Geometry *geometry, int v, GLfloat x, GLfloat y, GLfloat z,
+                                GLfloat u, GLfloat w) {
+  geometry->positions[v * 3 + 0] = x;
+  geometry->positions[v * 3 + 1] = y;
+  geometry->positions[v * 3 + 2] = z;
+  geometry->colors[v * 4 + 0] = u;
+  geometry->colors[v * 4 + 1] = w;
+  geometry->colors[v * 4 + 2] = 1.0 - u;
+  geometry->colors[v * 4 + 3] = 1.0;
+}
+
+/* Two triangles per cell of a (columns + 1) wide vertex lattice */
+static GLuint *geometry_lattice_indices(GLuint *index, GLuint first, int columns, int rows) {
+  int side = columns + 1;
+  for (int y = 0; y < rows; y++) {
+    for (int x = 0; x < columns; x++) {
+      GLuint v = first + y * side + x;
+      *index++ = v;
+      *index++ = v + 1;
+      *index++ = v + side;
+      *index++ = v + 1;
+      *index++ = v + side + 1;
+      *index++ = v + side;
+    }
+  }
+  return index;
+}
+
+void geometry_make_grid(Geometry *geometry, int quads, float extent) {
+  assert(quads > 0);
+  int side = quads + 1;
+  geometry_alloc(geometry, side * side, quads * quads * 6);
+
+  for (int y = 0; y < side; y++) {
+    for (int x = 0; x < side; x++) {
+      GLfloat u = (GLfloat)x / quads, w = (GLfloat)y / quads;
+      geometry_set_vertex(geometry, y * side + x, (u * 2.0 - 1.0) * extent, (w * 2.0 - 1.0) * extent, 0.0, u, w);
+    }
+  }
+  geometry_lattice_indices(geometry->indices, 0, quads, quads);
+
+  float visible = fminf(extent, 1.0f);
+  geometry->coverage = visible * visible;
+}
+
+void geometry_make_sphere(Geometry *geometry, int slices, int stacks, float radius) {
+  assert(slices >= 3 && stacks >= 2);
+  geometry_alloc(geometry, (slices + 1) * (stacks + 1), slices * stacks * 6);
+
+  for (int stack = 0; stack <= stacks; stack++) {
+    GLfloat w = (GLfloat)stack / stacks;
+    GLfloat theta = w * M_PI;
+    for (int slice = 0; slice <= slices; slice++) {
+      GLfloat u = (GLfloat)slice / slices;
+      GLfloat phi = u * 2.0 * M_PI;
+      geometry_set_vertex(geometry, stack * (slices + 1) + slice,
+                          radius * sinf(theta) * cosf(phi),
+                          radius * cosf(theta),
+                          radius * sinf(theta) * sinf(phi), u, w);
+    }
+  }
+  geometry_lattice_indices(geometry->indices, 0, slices, stacks);
+
+  /* Without culling both the front and back hemisphere get shaded */
+  float visible = fminf(radius, 1.0f);
+  geometry->coverage = 2.0f * (float)M_PI * visible * visible / 4.0f;
+}
+
+void geometry_make_quad_stack(Geometry *geometry, int layers, float extent) {
+  assert(layers > 0);
+  geometry_alloc(geometry, layers * 4, layers * 6);
+
+  GLuint *index = geometry->indices;
+  for (int layer = 0; layer < layers; layer++) {
+    GLfloat z = layers > 1 ? (GLfloat)layer / (layers - 1) * 2.0 - 1.0 : 0.0;
+    for (int corner = 0; corner < 4; corner++) {
+      GLfloat u = corner & 1, w = corner >> 1;
+      geometry_set_vertex(geometry, layer * 4 + corner, (u * 2.0 - 1.0) * extent, (w * 2.0 - 1.0) * extent, z * 0.99, u, w);
+    }
+    index = geometry_lattice_indices(index, layer * 4, 1, 1);
+  }
+
+  float visible = fminf(extent, 1.0f);
+  geometry->coverage = layers * visible * visible;
+}
+
+void geometry_destroy(Geometry *geometry) {
+  free(geometry->positions);
+  free(geometry->colors);
+  free(geometry->indices);
+  memset(geometry, 0, sizeof(*geometry));
+}
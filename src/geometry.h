@@ -0,0 +1,51 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <GLES3/gl31.h>
+
+/* Indexed triangle lists for throughput studies. Positions are xyz in clip
+ * space units, colors rgba. coverage is the estimated number of viewport
+ * sized layers shaded when drawn without depth test or culling, so
+ * coverage * width * height approximates the pixels per draw.
+ */
+typedef struct {
+  GLfloat *positions;
+  GLfloat *colors;
+  GLuint *indices;
+  int vertex_count;
+  int index_count;
+  float coverage;
+} Geometry;
+
+/* quads x quads cells spanning [-extent, extent] */
+void geometry_make_grid(Geometry *geometry, int quads, float extent);
+/* UV sphere with the given tessellation */
+void geometry_make_sphere(Geometry *geometry, int slices, int stacks, float radius);
+/* layers overlapping quads on top of each other, for overdraw */
+void geometry_make_quad_stack(Geometry *geometry, int layers, float extent);
+void geometry_destroy(Geometry *geometry);
+
+#endif /* GEOMETRY_H */
@@ -0,0 +1,214 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <EGL/egl.h>
+
+#include "gpu_timer.h"
+
+/* GL_EXT_disjoint_timer_query, gl2ext.h doesn't mix well with gl31.h */
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+#ifndef GL_TIMESTAMP_EXT
+#define GL_TIMESTAMP_EXT 0x8E28
+#endif
+#ifndef GL_QUERY_COUNTER_BITS_EXT
+#define GL_QUERY_COUNTER_BITS_EXT 0x8864
+#endif
+
+typedef void (*gl_get_query_object_ui64v_t)(GLuint id, GLenum pname, GLuint64 *params);
+typedef void (*gl_query_counter_t)(GLuint id, GLenum target);
+typedef void (*gl_get_queryiv_t)(GLenum target, GLenum pname, GLint *params);
+
+static gl_get_query_object_ui64v_t get_query_object_ui64v;
+static gl_query_counter_t query_counter;
+
+/* GL_GPU_DISJOINT_EXT is cleared by reading it and shared by every timer,
+ * so it is only read here and latched into a counter all timers compare
+ * against.
+ */
+static unsigned gpu_disjoint_events;
+
+static unsigned gpu_timer_poll_disjoint(void) {
+  GLint disjoint = 0;
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  if (disjoint) {
+    gpu_disjoint_events++;
+  }
+  return gpu_disjoint_events;
+}
+
+int gpu_timer_supported(void) {
+  static int supported = -1;
+
+  if (supported < 0) {
+    const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+    get_query_object_ui64v = (gl_get_query_object_ui64v_t) eglGetProcAddress("glGetQueryObjectui64vEXT");
+    supported = extensions && strstr(extensions, "GL_EXT_disjoint_timer_query") && get_query_object_ui64v;
+  }
+
+  return supported;
+}
+
+int gpu_timer_timestamps_supported(void) {
+  static int supported = -1;
+
+  if (supported < 0) {
+    supported = 0;
+    /* The extension allows zero counter bits, meaning no timestamps */
+    gl_get_queryiv_t get_queryiv = (gl_get_queryiv_t) eglGetProcAddress("glGetQueryivEXT");
+    query_counter = (gl_query_counter_t) eglGetProcAddress("glQueryCounterEXT");
+    if (gpu_timer_supported() && get_queryiv && query_counter) {
+      GLint bits = 0;
+      get_queryiv(GL_TIMESTAMP_EXT, GL_QUERY_COUNTER_BITS_EXT, &bits);
+      supported = bits > 0;
+    }
+  }
+
+  return supported;
+}
+
+uint64_t gpu_timer_now_ns(void) {
+  GLint64 now = 0;
+  glGetInteger64v(GL_TIMESTAMP_EXT, &now);
+  return now;
+}
+
+void gpu_timer_init(GpuTimer *timer) {
+  memset(timer, 0, sizeof(*timer));
+  timer->supported = gpu_timer_supported();
+  if (timer->supported) {
+    timer->disjoint_events = gpu_timer_poll_disjoint();
+    glGenQueries(GPU_TIMER_QUERIES, timer->queries);
+  }
+}
+
+void gpu_timer_init_timestamps(GpuTimer *timer) {
+  memset(timer, 0, sizeof(*timer));
+  timer->supported = gpu_timer_timestamps_supported();
+  timer->timestamps = 1;
+  if (timer->supported) {
+    timer->disjoint_events = gpu_timer_poll_disjoint();
+    glGenQueries(GPU_TIMER_QUERIES, timer->queries);
+    glGenQueries(GPU_TIMER_QUERIES, timer->end_queries);
+  }
+}
+
+void gpu_timer_destroy(GpuTimer *timer) {
+  if (timer->supported) {
+    glDeleteQueries(GPU_TIMER_QUERIES, timer->queries);
+    if (timer->timestamps) {
+      glDeleteQueries(GPU_TIMER_QUERIES, timer->end_queries);
+    }
+  }
+  memset(timer, 0, sizeof(*timer));
+}
+
+void gpu_timer_begin(GpuTimer *timer) {
+  if (!timer->supported || timer->active) {
+    return;
+  }
+
+  if (timer->count == GPU_TIMER_QUERIES) {
+    /* Nobody collected the oldest result, reuse its query */
+    timer->head = (timer->head + 1) % GPU_TIMER_QUERIES;
+    timer->count--;
+  }
+
+  int slot = (timer->head + timer->count) % GPU_TIMER_QUERIES;
+  if (timer->timestamps) {
+    query_counter(timer->queries[slot], GL_TIMESTAMP_EXT);
+  } else {
+    glBeginQuery(GL_TIME_ELAPSED_EXT, timer->queries[slot]);
+  }
+  timer->active = 1;
+}
+
+void gpu_timer_end(GpuTimer *timer) {
+  if (!timer->active) {
+    return;
+  }
+
+  if (timer->timestamps) {
+    int slot = (timer->head + timer->count) % GPU_TIMER_QUERIES;
+    query_counter(timer->end_queries[slot], GL_TIMESTAMP_EXT);
+  } else {
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+  }
+  timer->active = 0;
+  timer->count++;
+}
+
+int gpu_timer_collect_span(GpuTimer *timer, uint64_t *begin_ns, uint64_t *end_ns) {
+  if (!timer->supported || timer->count == 0) {
+    return 0;
+  }
+
+  /* Queries complete in order, so the last one tells for the pair */
+  GLuint query = timer->timestamps ? timer->end_queries[timer->head] : timer->queries[timer->head];
+  GLuint available = 0;
+  glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return 0;
+  }
+
+  /* A disjoint event (frequency change, context loss...) since the last
+   * check may have hit any query in flight, finished or not: drop them all.
+   */
+  unsigned disjoint_events = gpu_timer_poll_disjoint();
+  if (disjoint_events != timer->disjoint_events) {
+    timer->disjoint_events = disjoint_events;
+    timer->head = (timer->head + timer->count) % GPU_TIMER_QUERIES;
+    timer->count = 0;
+    return 0;
+  }
+
+  GLuint64 begin = 0, end = 0;
+  if (timer->timestamps) {
+    get_query_object_ui64v(timer->queries[timer->head], GL_QUERY_RESULT, &begin);
+  }
+  get_query_object_ui64v(query, GL_QUERY_RESULT, &end);
+  timer->head = (timer->head + 1) % GPU_TIMER_QUERIES;
+  timer->count--;
+
+  *begin_ns = begin;
+  *end_ns = end;
+  return 1;
+}
+
+int gpu_timer_collect(GpuTimer *timer, uint64_t *elapsed_ns) {
+  uint64_t begin, end;
+  int found = 0;
+
+  while (gpu_timer_collect_span(timer, &begin, &end)) {
+    *elapsed_ns = end - begin;
+    found = 1;
+  }
+  return found;
+}
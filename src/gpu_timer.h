@@ -0,0 +1,66 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <stdint.h>
+#include <GLES3/gl31.h>
+
+#define GPU_TIMER_QUERIES 4
+
+/* GPU elapsed time through GL_EXT_disjoint_timer_query. Results are read
+ * back a few frames later from a small ring of queries so collecting them
+ * never stalls the pipeline. In timestamp mode begin and end each write a
+ * GPU timestamp instead, which places the span on the GPU clock.
+ */
+typedef struct {
+  int supported;
+  int timestamps;
+  GLuint queries[GPU_TIMER_QUERIES];
+  GLuint end_queries[GPU_TIMER_QUERIES];  /* timestamp mode only */
+  int head;
+  int count;
+  int active;
+  unsigned disjoint_events;  /* disjoint events seen when last collecting */
+} GpuTimer;
+
+int gpu_timer_supported(void);
+
+int gpu_timer_timestamps_supported(void);
+/* Current GPU clock, comparable with timestamp mode spans */
+uint64_t gpu_timer_now_ns(void);
+
+void gpu_timer_init(GpuTimer *timer);
+void gpu_timer_init_timestamps(GpuTimer *timer);
+void gpu_timer_destroy(GpuTimer *timer);
+void gpu_timer_begin(GpuTimer *timer);
+void gpu_timer_end(GpuTimer *timer);
+/* Returns non-zero and stores the newest finished measurement, if any */
+int gpu_timer_collect(GpuTimer *timer, uint64_t *elapsed_ns);
+/* Timestamp mode: returns non-zero and stores the oldest finished span, with
+ * the GPU clock at begin and end. Call until it returns 0 to get them all.
+ */
+int gpu_timer_collect_span(GpuTimer *timer, uint64_t *begin_ns, uint64_t *end_ns);
+
+#endif /* GPU_TIMER_H */
@@ -0,0 +1,150 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "input_record.h"
+
+static const char input_record_magic[8] = { 'G', 'L', 'E', 'S', 'R', 'E', 'C', '1' };
+
+static void input_write_varint(FILE *file, uint64_t value) {
+  do {
+    unsigned char byte = value & 0x7f;
+    value >>= 7;
+    if (value) {
+      byte |= 0x80;
+    }
+    fputc(byte, file);
+  } while (value);
+}
+
+static int input_read_varint(FILE *file, uint64_t *value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = fgetc(file);
+    if (byte == EOF) {
+      return 0;
+    }
+    *value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void input_recorder_open(InputRecorder *recorder, const char *path) {
+  recorder->file = fopen(path, "wb");
+  if (!recorder->file) {
+    fprintf(stderr, "Error: couldn't create recording %s\n", path);
+    exit(1);
+  }
+  recorder->last_time_us = 0;
+  fwrite(input_record_magic, 1, sizeof(input_record_magic), recorder->file);
+}
+
+void input_recorder_write(InputRecorder *recorder, const input_event_t *event) {
+  uint64_t time_us = event->time_ns / 1000;
+  input_write_varint(recorder->file, time_us - recorder->last_time_us);
+  recorder->last_time_us = time_us;
+
+  fputc(event->type, recorder->file);
+  if (event->type == INPUT_EVENT_RESIZE) {
+    input_write_varint(recorder->file, event->a);
+    input_write_varint(recorder->file, event->b);
+  } else if (event->type == INPUT_EVENT_KEY) {
+    input_write_varint(recorder->file, event->a);
+  }
+}
+
+void input_recorder_close(InputRecorder *recorder) {
+  fclose(recorder->file);
+  recorder->file = NULL;
+}
+
+void input_replay_open(InputReplay *replay, const char *path) {
+  memset(replay, 0, sizeof(*replay));
+
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "Error: couldn't open recording %s\n", path);
+    exit(1);
+  }
+
+  char magic[sizeof(input_record_magic)];
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic)
+      || memcmp(magic, input_record_magic, sizeof(magic)) != 0) {
+    fprintf(stderr, "Error: %s is not an input recording\n", path);
+    exit(1);
+  }
+
+  int capacity = 0;
+  uint64_t time_us = 0;
+  uint64_t delta;
+  while (input_read_varint(file, &delta)) {
+    int type = fgetc(file);
+    uint64_t a = 0, b = 0;
+    int ok = (type != EOF);
+    if (ok && type == INPUT_EVENT_RESIZE) {
+      ok = input_read_varint(file, &a) && input_read_varint(file, &b);
+    } else if (ok && type == INPUT_EVENT_KEY) {
+      ok = input_read_varint(file, &a);
+    }
+    if (!ok || type > INPUT_EVENT_QUIT) {
+      fprintf(stderr, "Error: %s: corrupt event after %d events\n", path, replay->count);
+      exit(1);
+    }
+
+    if (replay->count == capacity) {
+      capacity = capacity ? capacity * 2 : 256;
+      replay->events = realloc(replay->events, sizeof(input_event_t) * capacity);
+      if (!replay->events) {
+        fprintf(stderr, "Error: out of memory reading %s\n", path);
+        exit(1);
+      }
+    }
+
+    time_us += delta;
+    input_event_t *event = &replay->events[replay->count++];
+    event->time_ns = time_us * 1000;
+    event->type = (enum input_event_type)type;
+    event->a = (uint32_t)a;
+    event->b = (uint32_t)b;
+  }
+
+  fclose(file);
+}
+
+int input_replay_next(InputReplay *replay, input_event_t *event) {
+  if (replay->next >= replay->count) {
+    return 0;
+  }
+  *event = replay->events[replay->next++];
+  return 1;
+}
+
+void input_replay_close(InputReplay *replay) {
+  free(replay->events);
+  memset(replay, 0, sizeof(*replay));
+}
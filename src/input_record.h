@@ -0,0 +1,66 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef INPUT_RECORD_H
+#define INPUT_RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum input_event_type {
+  INPUT_EVENT_EXPOSE,
+  INPUT_EVENT_RESIZE,  /* a: width, b: height */
+  INPUT_EVENT_KEY,     /* a: keysym */
+  INPUT_EVENT_QUIT,
+};
+
+typedef struct {
+  uint64_t time_ns;  /* since the start of the event loop */
+  enum input_event_type type;
+  uint32_t a;
+  uint32_t b;
+} input_event_t;
+
+/* Files start with a magic and hold one record per event: the time delta
+ * in microseconds and the payload as LEB128 varints after a type byte.
+ */
+typedef struct {
+  FILE *file;
+  uint64_t last_time_us;
+} InputRecorder;
+
+typedef struct {
+  input_event_t *events;
+  int count;
+  int next;
+} InputReplay;
+
+void input_recorder_open(InputRecorder *recorder, const char *path);
+void input_recorder_write(InputRecorder *recorder, const input_event_t *event);
+void input_recorder_close(InputRecorder *recorder);
+
+void input_replay_open(InputReplay *replay, const char *path);
+int input_replay_next(InputReplay *replay, input_event_t *event);
+void input_replay_close(InputReplay *replay);
+
+#endif /* INPUT_RECORD_H */
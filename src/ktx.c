@@ -0,0 +1,259 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ktx.h"
+
+static const unsigned char ktx_identifier[12] = {
+  0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+enum {
+  KTX_ENDIANNESS, KTX_GL_TYPE, KTX_GL_TYPE_SIZE, KTX_GL_FORMAT, KTX_GL_INTERNAL_FORMAT,
+  KTX_GL_BASE_INTERNAL_FORMAT, KTX_WIDTH, KTX_HEIGHT, KTX_DEPTH, KTX_ARRAY_ELEMENTS,
+  KTX_FACES, KTX_MIPMAP_LEVELS, KTX_KEY_VALUE_BYTES, KTX_HEADER_FIELDS
+};
+
+static uint32_t ktx_swap32(uint32_t value) {
+  return ((value & 0xff) << 24) | ((value & 0xff00) << 8)
+       | ((value >> 8) & 0xff00) | (value >> 24);
+}
+
+static int ktx_is_etc2(GLenum internal_format) {
+  return internal_format >= GL_COMPRESSED_R11_EAC
+      && internal_format <= GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+}
+
+/* ETC2/EAC data comes in 4x4 blocks of 8 or 16 bytes */
+static size_t ktx_etc2_block_bytes(GLenum internal_format) {
+  switch (internal_format) {
+  case GL_COMPRESSED_RG11_EAC: case GL_COMPRESSED_SIGNED_RG11_EAC:
+  case GL_COMPRESSED_RGBA8_ETC2_EAC: case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+    return 16;
+  default:
+    return 8;
+  }
+}
+
+static int ktx_format_components(GLenum format) {
+  switch (format) {
+  case GL_RED: case GL_RED_INTEGER: case GL_LUMINANCE: case GL_ALPHA: case GL_DEPTH_COMPONENT:
+    return 1;
+  case GL_RG: case GL_RG_INTEGER: case GL_LUMINANCE_ALPHA:
+    return 2;
+  case GL_RGB: case GL_RGB_INTEGER:
+    return 3;
+  case GL_RGBA: case GL_RGBA_INTEGER:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+/* Bytes per pixel, 0 for combinations this loader doesn't know */
+static size_t ktx_pixel_bytes(GLenum format, GLenum type) {
+  switch (type) {
+  case GL_UNSIGNED_BYTE: case GL_BYTE:
+    return ktx_format_components(format);
+  case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+    return 2 * ktx_format_components(format);
+  case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+    return 4 * ktx_format_components(format);
+  case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+    return 2;
+  case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_10F_11F_11F_REV:
+  case GL_UNSIGNED_INT_5_9_9_9_REV: case GL_UNSIGNED_INT_24_8:
+    return 4;
+  case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+/* What glCompressedTexSubImage2D/glTexSubImage2D read for one level; KTX
+ * pads uncompressed rows to 4 bytes, matching GL_UNPACK_ALIGNMENT 4.
+ */
+static size_t ktx_level_bytes(GLenum internal_format, GLenum format, GLenum type, size_t width, size_t height) {
+  if (format == 0) {
+    return ((width + 3) / 4) * ((height + 3) / 4) * ktx_etc2_block_bytes(internal_format);
+  }
+  return ((width * ktx_pixel_bytes(format, type) + 3) & ~(size_t)3) * height;
+}
+
+/* Base formats are fine for glTexImage2D but glTexStorage2D wants a size */
+static int ktx_is_unsized(GLenum internal_format) {
+  switch (internal_format) {
+  case GL_RED: case GL_RG: case GL_RGB: case GL_RGBA:
+  case GL_LUMINANCE: case GL_ALPHA: case GL_LUMINANCE_ALPHA:
+  case GL_DEPTH_COMPONENT: case GL_DEPTH_STENCIL:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+const char *ktx_parse(const unsigned char *file, size_t size, KtxImage *image) {
+  uint32_t header[KTX_HEADER_FIELDS];
+
+  memset(image, 0, sizeof(*image));
+  if (size < sizeof(ktx_identifier) + sizeof(header) || memcmp(file, ktx_identifier, sizeof(ktx_identifier)) != 0) {
+    return "not a KTX file";
+  }
+  memcpy(header, file + sizeof(ktx_identifier), sizeof(header));
+
+  int swap = (header[KTX_ENDIANNESS] == 0x01020304);
+  if (swap) {
+    for (int i = 0; i < KTX_HEADER_FIELDS; i++) {
+      header[i] = ktx_swap32(header[i]);
+    }
+  } else if (header[KTX_ENDIANNESS] != 0x04030201) {
+    return "bad endianness marker";
+  }
+
+  if (header[KTX_DEPTH] > 1 || header[KTX_ARRAY_ELEMENTS] > 0 || header[KTX_FACES] != 1) {
+    return "only plain 2D KTX textures are supported";
+  }
+
+  int compressed = (header[KTX_GL_TYPE] == 0);
+  if (compressed && !ktx_is_etc2(header[KTX_GL_INTERNAL_FORMAT])) {
+    return "unsupported compressed format";
+  }
+  if (!compressed && ktx_is_unsized(header[KTX_GL_INTERNAL_FORMAT])) {
+    return "unsized internal format, glTexStorage2D needs a sized one";
+  }
+  if (!compressed && ktx_pixel_bytes(header[KTX_GL_FORMAT], header[KTX_GL_TYPE]) == 0) {
+    return "unsupported pixel format or type";
+  }
+  if (!compressed && swap && header[KTX_GL_TYPE_SIZE] > 1) {
+    return "byte swapping of pixel data is not supported";
+  }
+  GLenum format = compressed ? 0 : header[KTX_GL_FORMAT];
+
+  uint32_t width = header[KTX_WIDTH];
+  uint32_t height = header[KTX_HEIGHT] ? header[KTX_HEIGHT] : 1;
+  if (width == 0 || width > 65536 || height > 65536) {
+    return "bad texture size";
+  }
+
+  /* glTexStorage2D refuses more levels than the size can halve to 1x1 */
+  int max_levels = 1;
+  while (((width | height) >> max_levels) != 0) {
+    max_levels++;
+  }
+  int level_count = header[KTX_MIPMAP_LEVELS] ? (int)header[KTX_MIPMAP_LEVELS] : 1;
+  if (level_count > max_levels) {
+    return "more mipmap levels than the size allows";
+  }
+
+  size_t offset = sizeof(ktx_identifier) + sizeof(header);
+  if (header[KTX_KEY_VALUE_BYTES] > size - offset) {
+    return "truncated KTX file";
+  }
+  offset += header[KTX_KEY_VALUE_BYTES];
+
+  for (int level = 0; level < level_count; level++) {
+    uint32_t image_size;
+    if (size - offset < sizeof(image_size)) {
+      return "truncated KTX file";
+    }
+    memcpy(&image_size, file + offset, sizeof(image_size));
+    if (swap) {
+      image_size = ktx_swap32(image_size);
+    }
+    offset += sizeof(image_size);
+    if (image_size > size - offset) {
+      return "truncated KTX file";
+    }
+    size_t level_width = (width >> level) ? (width >> level) : 1;
+    size_t level_height = (height >> level) ? (height >> level) : 1;
+    if (image_size != ktx_level_bytes(header[KTX_GL_INTERNAL_FORMAT], format, header[KTX_GL_TYPE],
+                                      level_width, level_height)) {
+      return "mipmap level size doesn't match its dimensions";
+    }
+
+    image->level_offset[level] = offset;
+    image->level_size[level] = image_size;
+    offset += (image_size + 3) & ~3u;  /* mipPadding */
+    if (offset > size) {
+      offset = size;
+    }
+  }
+
+  image->internal_format = header[KTX_GL_INTERNAL_FORMAT];
+  image->format = format;
+  image->type = header[KTX_GL_TYPE];
+  image->width = width;
+  image->height = height;
+  image->levels = level_count;
+  return NULL;
+}
+
+unsigned char *ktx_build(GLenum internal_format, GLenum format, GLenum type, int width, int height,
+                         int levels, const void *const *level_data, const size_t *level_size,
+                         size_t *size) {
+  uint32_t header[KTX_HEADER_FIELDS];
+
+  size_t total = sizeof(ktx_identifier) + sizeof(header);
+  for (int level = 0; level < levels; level++) {
+    total += sizeof(uint32_t) + ((level_size[level] + 3) & ~(size_t)3);
+  }
+
+  unsigned char *file = calloc(1, total);
+  if (!file) {
+    fprintf(stderr, "Error: out of memory for KTX file (%zu bytes)\n", total);
+    exit(1);
+  }
+
+  memset(header, 0, sizeof(header));
+  header[KTX_ENDIANNESS] = 0x04030201;
+  header[KTX_GL_TYPE] = type;
+  header[KTX_GL_TYPE_SIZE] = 1;
+  header[KTX_GL_FORMAT] = format;
+  header[KTX_GL_INTERNAL_FORMAT] = internal_format;
+  header[KTX_GL_BASE_INTERNAL_FORMAT] = format;
+  header[KTX_WIDTH] = width;
+  header[KTX_HEIGHT] = height;
+  header[KTX_FACES] = 1;
+  header[KTX_MIPMAP_LEVELS] = levels;
+
+  size_t offset = 0;
+  memcpy(file + offset, ktx_identifier, sizeof(ktx_identifier));
+  offset += sizeof(ktx_identifier);
+  memcpy(file + offset, header, sizeof(header));
+  offset += sizeof(header);
+  for (int level = 0; level < levels; level++) {
+    uint32_t image_size = level_size[level];
+    memcpy(file + offset, &image_size, sizeof(image_size));
+    offset += sizeof(image_size);
+    memcpy(file + offset, level_data[level], level_size[level]);
+    offset += (level_size[level] + 3) & ~(size_t)3;
+  }
+
+  *size = total;
+  return file;
+}
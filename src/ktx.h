@@ -0,0 +1,58 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KTX_H
+#define KTX_H
+
+#include <stddef.h>
+#include <GLES3/gl31.h>
+
+#define KTX_MAX_LEVELS 32
+
+/* A parsed KTX 1.1 file, the level data stays in the caller's buffer */
+typedef struct {
+  GLenum internal_format;
+  GLenum format;  /* 0 for compressed data */
+  GLenum type;
+  int width;
+  int height;
+  int levels;
+  size_t level_offset[KTX_MAX_LEVELS];
+  size_t level_size[KTX_MAX_LEVELS];
+} KtxImage;
+
+/* Accepts plain 2D textures that glTexStorage2D can hold: ETC2/EAC or
+ * uncompressed data with a sized internal format, every level exactly as
+ * large as its dimensions need. Returns NULL on success, otherwise why the
+ * file was rejected. No GL calls, safe on any thread.
+ */
+const char *ktx_parse(const unsigned char *file, size_t size, KtxImage *image);
+
+/* Builds an uncompressed KTX file in memory, level_data[i] holds level i.
+ * Returns a malloc'ed buffer of *size bytes.
+ */
+unsigned char *ktx_build(GLenum internal_format, GLenum format, GLenum type, int width, int height,
+                         int levels, const void *const *level_data, const size_t *level_size,
+                         size_t *size);
+
+#endif /* KTX_H */
@@ -27,11 +27,21 @@
 
 #include "matrix.h"
 
+void matrix_make_identity(GLfloat *matrix) {
+  assert(matrix != 0);
+  for (int i = 0; i < 16; i++) {
+    matrix[i] = 0.0;
+  }
+  matrix[0] = matrix[5] = matrix[10] = matrix[15] = 1.0;
+}
+
 void matrix_make_rotate_z(GLfloat *matrix, GLfloat angle) {
   // Set the input matrix to a simple rotation matrix
   assert(matrix != 0);
-  float c = cos(angle * M_PI / 180.0);
-  float s = sin(angle * M_PI / 180.0);
+  // Single precision is all a GLfloat matrix can hold anyway
+  float radians = angle * (float)(M_PI / 180.0);
+  float c = cosf(radians);
+  float s = sinf(radians);
 
   for (int i = 0; i < 16; i++) {
     matrix[i] = 0.0;
@@ -70,5 +80,30 @@ void matrix_mul(GLfloat *prod, const GLfloat *a, const GLfloat *b) {
   memcpy(prod, p, sizeof(p));
 #undef A
 #undef B
-#undef PROD
+#undef P
+}
+
+void matrix_frustum_planes(GLfloat *planes, const GLfloat *mvp) {
+  // Clip space planes (left, right, bottom, top, near, far) as a*x + b*y + c*z + d,
+  // normalized so the plane distance of a point is in world units
+#define M(row,col)  mvp[(col<<2)+row]
+  assert(planes != 0);
+  for (int i = 0; i < 6; i++) {
+    int axis = i >> 1;
+    GLfloat sign = (i & 1) ? -1.0 : 1.0;
+    GLfloat length = 0.0;
+    for (int col = 0; col < 4; col++) {
+      planes[i * 4 + col] = M(3, col) + sign * M(axis, col);
+      if (col < 3) {
+        length += planes[i * 4 + col] * planes[i * 4 + col];
+      }
+    }
+    length = sqrtf(length);
+    if (length > 0.0) {
+      for (int col = 0; col < 4; col++) {
+        planes[i * 4 + col] /= length;
+      }
+    }
+  }
+#undef M
 }
@@ -26,8 +26,10 @@
 
 #include <GLES3/gl31.h>
 
+void matrix_make_identity(GLfloat *matrix);
 void matrix_make_rotate_z(GLfloat *matrix, GLfloat angle);
 void matrix_make_scale(GLfloat *matrix, GLfloat xs, GLfloat ys, GLfloat zs);
 void matrix_mul(GLfloat *prod, const GLfloat *a, const GLfloat *b);
+void matrix_frustum_planes(GLfloat *planes, const GLfloat *mvp);
 
 #endif /* MATRIX_H */
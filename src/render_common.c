@@ -22,11 +22,18 @@
  */
 
 #include "render_common.h"
+#include "bench.h"
+#include "frame_pacing.h"
+#include "gpu_timer.h"
+#include "input_record.h"
+#include "render_target.h"
+#include "trace.h"
 
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <X11/keysym.h>
 
 #include <GLES3/gl3ext.h>
@@ -52,6 +59,7 @@ EGLint egl_query_context_int(const EglInfo egl, const EGLenum key) {
 }
 
 void egl_print_infos(const EglInfo egl) {
+  TRACE_SCOPE("egl_print_infos");
   char const *version = eglQueryString(egl.display, EGL_VERSION);
   char const *vendor = eglQueryString(egl.display, EGL_VENDOR);
   char const *extensions = eglQueryString(egl.display, EGL_EXTENSIONS);
@@ -74,6 +82,8 @@ EGLDisplay egl_get_display(Display *display) {
 }
 
 void egl_init(EglInfo *egl) {
+  TRACE_SCOPE("egl_init");
+
   if (!eglInitialize(egl->display, &egl->major, &egl->minor)) {
     printf("Error: eglInitialize() failed\n");
     exit(-2);
@@ -83,6 +93,7 @@ void egl_init(EglInfo *egl) {
 }
 
 EGLConfig egl_choose_config(EGLDisplay egl_dpy, const EGLint *attribs) {
+  TRACE_SCOPE("egl_choose_config");
   EGLConfig config;
   EGLint num_configs;
 
@@ -98,6 +109,7 @@ EGLConfig egl_choose_config(EGLDisplay egl_dpy, const EGLint *attribs) {
 }
 
 EGLConfig egl_create_context(EglInfo egl, const EGLint *attribs) {
+  TRACE_SCOPE("egl_create_context");
   EGLContext ctx = eglCreateContext(egl.display, egl.config, EGL_NO_CONTEXT, attribs);
   if (!ctx) {
     fprintf(stderr, "Error: eglCreateContext failed\n");
@@ -108,6 +120,7 @@ EGLConfig egl_create_context(EglInfo egl, const EGLint *attribs) {
 }
 
 void egl_make_current(const EglInfo egl) {
+  TRACE_SCOPE("egl_make_current");
   if (!eglMakeCurrent(egl.display, egl.surface, egl.surface, egl.context)) {
     fprintf(stderr, "Error: eglMakeCurrent() failed\n");
     exit(-1);
@@ -116,6 +129,7 @@ void egl_make_current(const EglInfo egl) {
 
 
 EGLSurface egl_create_window_surface(EglInfo egl, Window win) {
+  TRACE_SCOPE("egl_create_window_surface");
   EGLSurface surface = eglCreateWindowSurface(egl.display, egl.config, win, NULL);
   if (!surface) {
     fprintf(stderr, "Error: eglCreateWindowSurface failed\n");
@@ -145,8 +159,24 @@ void gl_print_info() {
     printf("GL_EXTENSIONS = %s\n", (char *) glGetString(GL_EXTENSIONS));
 }
 
+static render_view_t render_view;
+
+void render_bind_view(GLuint framebuffer, GLint x, GLint y, GLsizei width, GLsizei height) {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(x, y, width, height);
+  render_view.framebuffer = framebuffer;
+  render_view.viewport[0] = x;
+  render_view.viewport[1] = y;
+  render_view.viewport[2] = width;
+  render_view.viewport[3] = height;
+}
+
+const render_view_t *render_current_view(void) {
+  return &render_view;
+}
+
 void reshape(window_size_t win_size) {
-  glViewport(0, 0, (GLint)win_size.width, (GLint)win_size.height);
+  render_bind_view(0, 0, 0, (GLint)win_size.width, (GLint)win_size.height);
 }
 
 
@@ -167,6 +197,7 @@ XVisualInfo *get_visual_info(Display *x_dpy, EGLint vid) {
 }
 
 Window x_create_window(const EglInfo egl, Display *x_dpy, window_size_t win_size, const char *name) {
+  TRACE_SCOPE("x_create_window");
   EGLint vid = egl_get_config_attrib_int(egl, EGL_NATIVE_VISUAL_ID);
   XVisualInfo *visInfo = get_visual_info(x_dpy, vid);
   int scrnum = DefaultScreen(x_dpy);
@@ -201,6 +232,7 @@ Window x_create_window(const EglInfo egl, Display *x_dpy, window_size_t win_size
 
 
 Display *x_open_display(const char* dpyName) {
+  TRACE_SCOPE("x_open_display");
   Display *display = XOpenDisplay(dpyName);
   if (!display) {
     fprintf(stderr, "Error: couldn't open display %s\n", dpyName ? dpyName : getenv("DISPLAY"));
@@ -211,60 +243,252 @@ Display *x_open_display(const char* dpyName) {
 }
 
 /* Render helpers */
-void render_event_loop(RenderContext renderCtx, void *user_data) {
-  static view_rotation_t view_rotation = { 0.0, 0.0 };
+static void render_translate_event(const XEvent *xevent, input_event_t *event) {
+  memset(event, 0, sizeof(*event));
+
+  switch (xevent->type) {
+  case ConfigureNotify:
+    event->type = INPUT_EVENT_RESIZE;
+    event->a = xevent->xconfigure.width;
+    event->b = xevent->xconfigure.height;
+    break;
+  case KeyPress: {
+    XKeyEvent key = xevent->xkey;
+    KeySym code = XLookupKeysym(&key, 0);
+    event->type = (code == XK_Escape) ? INPUT_EVENT_QUIT : INPUT_EVENT_KEY;
+    event->a = (uint32_t)code;
+    break;
+  }
+  default:
+    /* Anything else only causes a redraw */
+    event->type = INPUT_EVENT_EXPOSE;
+  }
+}
+
+static void render_sleep_until(uint64_t deadline_ns) {
+  struct timespec deadline;
+  deadline.tv_sec = deadline_ns / 1000000000ull;
+  deadline.tv_nsec = deadline_ns % 1000000000ull;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) != 0) {
+    ; /* interrupted, sleep again */
+  }
+}
+
+/* events.rec -> events.<example>.rec */
+static const char *render_example_path(const RenderContext *renderCtx, const char *path,
+                                       char *buffer, size_t size) {
+  if (!renderCtx->options.per_example_files) {
+    return path;
+  }
+
+  const char *slash = strrchr(path, '/');
+  const char *dot = strrchr(path, '.');
+  int stem = (dot && dot > (slash ? slash + 1 : path)) ? (int)(dot - path) : (int)strlen(path);
+  int length = snprintf(buffer, size, "%.*s.%s%s", stem, path, renderCtx->name, path + stem);
+  if (length < 0 || (size_t)length >= size) {
+    fprintf(stderr, "Error: file name too long for %s\n", path);
+    exit(1);
+  }
+  return buffer;
+}
 
-  while (1) {
-    int redraw = 0;
-    XEvent event;
+void render_event_loop(RenderContext *renderCtx, void *user_data) {
+  view_rotation_t view_rotation = { 0.0, 0.0 };
+  const RenderOptions *options = &renderCtx->options;
 
-    XNextEvent(renderCtx.X.display, &event);
+  FramePacer pacer;
+  frame_pacer_init(&pacer, options->max_frames_in_flight, options->report_latency);
+
+  RenderTarget target;
+  int use_target = options->dynres_target_ms > 0.0f;
+  if (use_target) {
+    render_target_init(&target, renderCtx->window_size, options->dynres_target_ms);
+  }
+
+  char path[1024];
+  InputRecorder recorder;
+  if (options->record_path) {
+    input_recorder_open(&recorder, render_example_path(renderCtx, options->record_path, path, sizeof(path)));
+  }
+
+  InputReplay replay;
+  if (options->replay_path) {
+    input_replay_open(&replay, render_example_path(renderCtx, options->replay_path, path, sizeof(path)));
+  }
+
+  /* GPU side of the trace, GPU timestamps moved onto the trace clock */
+  GpuTimer gpu_trace;
+  int use_gpu_trace = trace_enabled && gpu_timer_timestamps_supported();
+  int64_t gpu_trace_offset = 0;
+  if (use_gpu_trace) {
+    gpu_timer_init_timestamps(&gpu_trace);
+    gpu_trace_offset = (int64_t)(trace_now_ns() - gpu_timer_now_ns());
+  }
+
+  /* Timed runs: replays, or drawing continuously without waiting for events */
+  int benchmark = !options->replay_path && options->benchmark_frames > 0;
+  int paced_replay = options->replay_path && !options->replay_fast;
+  int frames = 0;
+  FrameStats stats;
+  frame_stats_init(&stats);
+
+  uint64_t start_time = frame_pacer_now_ns();
+  int running = 1;
+  while (running) {
+    XEvent xevent;
+    input_event_t event;
+    TraceScope event_scope = trace_begin("event");
+
+    if (options->replay_path) {
+      /* Live input is ignored while replaying, except escape to give up */
+      while (XPending(renderCtx->X.display)) {
+        XNextEvent(renderCtx->X.display, &xevent);
+        render_translate_event(&xevent, &event);
+        if (event.type == INPUT_EVENT_QUIT) {
+          running = 0;
+        }
+      }
+      if (!running || !input_replay_next(&replay, &event)) {
+        break;
+      }
+      if (!options->replay_fast) {
+        render_sleep_until(start_time + event.time_ns);
+      }
+    } else if (benchmark) {
+      if (frames >= options->benchmark_frames) {
+        break;
+      }
+      if (XPending(renderCtx->X.display)) {
+        XNextEvent(renderCtx->X.display, &xevent);
+        render_translate_event(&xevent, &event);
+      } else {
+        memset(&event, 0, sizeof(event));
+        event.type = INPUT_EVENT_EXPOSE;
+      }
+      event.time_ns = frame_pacer_now_ns() - start_time;
+    } else {
+      XNextEvent(renderCtx->X.display, &xevent);
+      render_translate_event(&xevent, &event);
+      event.time_ns = frame_pacer_now_ns() - start_time;
+    }
+    trace_end(&event_scope);
+
+    if (options->record_path) {
+      input_recorder_write(&recorder, &event);
+    }
 
     switch (event.type) {
-    case Expose:
-      redraw = 1;
+    case INPUT_EVENT_EXPOSE:
       break;
-    case ConfigureNotify: {
-      window_size_t win_size = { event.xconfigure.width, event.xconfigure.height };
+    case INPUT_EVENT_RESIZE: {
+      window_size_t win_size = { (int)event.a, (int)event.b };
       reshape(win_size);
+      renderCtx->window_size = win_size;
+      if (use_target) {
+        render_target_resize(&target, win_size);
+      }
       break;
     }
-    case KeyPress:
-      {
-        char buffer[10];
-        int r, code;
-        code = XLookupKeysym(&event.xkey, 0);
-        if (code == XK_Left) {
-          view_rotation.y += 5.0;
-        } else if (code == XK_Right) {
-          view_rotation.y -= 5.0;
-        } else if (code == XK_Up) {
-          view_rotation.x += 5.0;
-        } else if (code == XK_Down) {
-          view_rotation.x -= 5.0;
-        } else {
-          r = XLookupString(&event.xkey, buffer, sizeof(buffer), NULL, NULL);
-          if (buffer[0] == 27) {
-            /* escape */
-            return;
-          }
-        }
+    case INPUT_EVENT_KEY:
+      /* Replayed events arrive when they are handed out, not at their
+       * recorded time, which fast replay doesn't wait for.
+       */
+      frame_pacer_input(&pacer, options->replay_path ? frame_pacer_now_ns()
+                                                     : start_time + event.time_ns);
+      if (event.a == XK_Left) {
+        view_rotation.y += 5.0;
+      } else if (event.a == XK_Right) {
+        view_rotation.y -= 5.0;
+      } else if (event.a == XK_Up) {
+        view_rotation.x += 5.0;
+      } else if (event.a == XK_Down) {
+        view_rotation.x -= 5.0;
       }
-      redraw = 1;
       break;
-    default:
-      ; /*no-op*/
+    case INPUT_EVENT_QUIT:
+      running = 0;
+      continue;
     }
 
-    if (redraw || 1) {
-      renderCtx.callbacks.draw(view_rotation, user_data);
-      eglSwapBuffers(renderCtx.Egl.display, renderCtx.Egl.surface);
+    /* Handle everything already queued before drawing, so events don't sit
+     * in the queue behind a frame that doesn't show them yet.
+     */
+    if (!options->replay_path && !benchmark && XPending(renderCtx->X.display)) {
+      continue;
     }
+
+    uint64_t frame_start = frame_pacer_now_ns();
+    TraceScope frame_scope = trace_begin("frame");
+    {
+      TRACE_SCOPE("frame_pacing");
+      frame_pacer_begin_frame(&pacer);
+    }
+    {
+      TRACE_SCOPE("draw");
+      if (use_gpu_trace) {
+        gpu_timer_begin(&gpu_trace);
+      }
+      if (use_target) {
+        render_target_begin(&target);
+      }
+      renderCtx->callbacks.draw(view_rotation, user_data);
+      if (use_target) {
+        render_target_end(&target);
+      }
+      if (use_gpu_trace) {
+        gpu_timer_end(&gpu_trace);
+      }
+    }
+    {
+      TRACE_SCOPE("swap");
+      eglSwapBuffers(renderCtx->Egl.display, renderCtx->Egl.surface);
+    }
+    uint64_t frame_end = frame_pacer_now_ns();
+    frame_pacer_end_frame(&pacer);
+    trace_end(&frame_scope);
+
+    uint64_t gpu_begin, gpu_end;
+    while (use_gpu_trace && gpu_timer_collect_span(&gpu_trace, &gpu_begin, &gpu_end)) {
+      trace_span("gpu frame", gpu_begin + gpu_trace_offset, gpu_end + gpu_trace_offset, TRACE_TRACK_GPU);
+    }
+
+    if (paced_replay) {
+      /* The time between frames is the recorded gap between events */
+      frame_stats_add(&stats, frame_end - frame_start);
+    } else {
+      frame_stats_tick(&stats, frame_end);
+    }
+    frames++;
+  }
+
+  if (options->record_path) {
+    input_recorder_close(&recorder);
   }
+  if (options->replay_path || benchmark) {
+    char label[128];
+    snprintf(label, sizeof(label), "%s %s", renderCtx->name,
+             benchmark ? "benchmark" : paced_replay ? "replay (draw+swap time)" : "replay (fast)");
+    frame_stats_report(&stats, label);
+  }
+  if (options->replay_path) {
+    input_replay_close(&replay);
+  }
+  frame_stats_destroy(&stats);
+  if (use_target) {
+    printf("Dynamic resolution: final scale %.2f (%dx%d)\n", target.scale, target.scaled.width, target.scaled.height);
+    render_target_destroy(&target);
+  }
+  if (use_gpu_trace) {
+    gpu_timer_destroy(&gpu_trace);
+  }
+  frame_pacer_destroy(&pacer);
+  frame_pacer_report(&pacer);
 }
 
 
 void render_create_context(RenderContext *renderCtx) {
+  TRACE_SCOPE("render_create_context");
+
   static const EGLint attribs[] = {
     EGL_RED_SIZE, 1,
     EGL_GREEN_SIZE, 1,
@@ -298,11 +522,18 @@ void render_cleanup(RenderContext renderCtx) {
   XCloseDisplay(renderCtx.X.display);
 }
 
-int render_main(int argc, char *argv[], RenderCallbacks callbacks) {
-  RenderContext renderCtx;
-  renderCtx.window_size.height = 300;
-  renderCtx.window_size.width = 300;
-  renderCtx.callbacks = callbacks;
+void render_init(int argc, char *argv[], RenderContext *renderCtx) {
+  renderCtx->window_size.height = 300;
+  renderCtx->window_size.width = 300;
+  renderCtx->options.max_frames_in_flight = 0;
+  renderCtx->options.report_latency = 0;
+  renderCtx->options.dynres_target_ms = 0.0f;
+  renderCtx->options.record_path = NULL;
+  renderCtx->options.replay_path = NULL;
+  renderCtx->options.replay_fast = 0;
+  renderCtx->options.benchmark_frames = 0;
+  renderCtx->options.trace_path = NULL;
+  renderCtx->options.per_example_files = 0;
 
   char *dpyName = NULL;
   GLboolean printInfo = GL_FALSE;
@@ -313,34 +544,106 @@ int render_main(int argc, char *argv[], RenderCallbacks callbacks) {
       i++;
     } else if (strcmp(argv[i], "-info") == 0) {
       printInfo = GL_TRUE;
+    } else if (strcmp(argv[i], "-frames-in-flight") == 0 && i + 1 < argc) {
+      renderCtx->options.max_frames_in_flight = atoi(argv[i + 1]);
+      i++;
+    } else if (strcmp(argv[i], "-latency") == 0) {
+      renderCtx->options.report_latency = 1;
+    } else if (strcmp(argv[i], "-dynres") == 0 && i + 1 < argc) {
+      renderCtx->options.dynres_target_ms = atof(argv[i + 1]);
+      i++;
+    } else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc) {
+      renderCtx->options.record_path = argv[i + 1];
+      i++;
+    } else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc) {
+      renderCtx->options.replay_path = argv[i + 1];
+      i++;
+    } else if (strcmp(argv[i], "-replay-fast") == 0) {
+      renderCtx->options.replay_fast = 1;
+    } else if (strcmp(argv[i], "-benchmark") == 0 && i + 1 < argc) {
+      renderCtx->options.benchmark_frames = atoi(argv[i + 1]);
+      i++;
+    } else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+      renderCtx->options.trace_path = argv[i + 1];
+      i++;
     } else {
       printf("Usage:\n");
       printf("  -display <displayname>  set the display to run on\n");
       printf("  -info                   display OpenGL renderer info\n");
+      printf("  -frames-in-flight <n>   wait on the GPU so at most n frames are queued\n");
+      printf("  -latency                report input-to-GPU-completion latency at exit\n");
+      printf("  -dynres <ms>            scale the render resolution to keep GPU time under ms\n");
+      printf("  -record <file>          record input and window events to file\n");
+      printf("                          (file.<example>.ext for each of several examples)\n");
+      printf("  -replay <file>          replay recorded events and report frame times\n");
+      printf("  -replay-fast            replay without waiting for the recorded timestamps\n");
+      printf("  -benchmark <frames>     draw continuously for n frames and report frame times\n");
+      printf("  -trace <file>           write a Chrome trace event timeline to file at exit\n");
       exit(-1);
     }
   }
 
-  renderCtx.X.display = x_open_display(dpyName);
-  renderCtx.Egl.display = egl_get_display(renderCtx.X.display);
+  if (renderCtx->options.trace_path) {
+    trace_enable(renderCtx->options.trace_path);
+  }
+  TraceScope startup = trace_begin("render_init");
+
+  renderCtx->X.display = x_open_display(dpyName);
+  renderCtx->Egl.display = egl_get_display(renderCtx->X.display);
 
-  egl_init(&renderCtx.Egl);
-  render_create_context(&renderCtx);
-  XMapWindow(renderCtx.X.display, renderCtx.X.window);
+  egl_init(&renderCtx->Egl);
+  render_create_context(renderCtx);
+  XMapWindow(renderCtx->X.display, renderCtx->X.window);
 
-  egl_make_current(renderCtx.Egl);
+  egl_make_current(renderCtx->Egl);
 
   if (printInfo) {
     gl_print_info();
   }
+  trace_end(&startup);
+}
 
-  void *user_data;
-  renderCtx.callbacks.initializer(renderCtx, &user_data);
+/* Puts back the state examples commonly change, so the next one starts clean */
+static void render_reset_gl_state(void) {
+  GLint attribs = 0;
+  glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attribs);
 
-  reshape(renderCtx.window_size);
+  glUseProgram(0);
+  glBindVertexArray(0);
+  for (int i = 0; i < attribs; i++) {
+    glDisableVertexAttribArray(i);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_BLEND);
+  glDisable(GL_CULL_FACE);
+}
+
+void render_run(RenderContext *renderCtx, const char *name, RenderCallbacks callbacks) {
+  renderCtx->name = name;
+  renderCtx->callbacks = callbacks;
+  TraceScope run = trace_begin(name);
+
+  void *user_data = NULL;
+  {
+    TRACE_SCOPE("init");
+    renderCtx->callbacks.initializer(*renderCtx, &user_data);
+  }
+
+  reshape(renderCtx->window_size);
 
   render_event_loop(renderCtx, user_data);
-  render_cleanup(renderCtx);
 
-  return 0;
+  {
+    TRACE_SCOPE("cleanup");
+    if (renderCtx->callbacks.cleanup) {
+      renderCtx->callbacks.cleanup(user_data);
+    }
+    render_reset_gl_state();
+  }
+  trace_end(&run);
 }
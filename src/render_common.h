@@ -39,6 +39,7 @@ typedef struct RenderContext RenderContext;
 
 typedef void (*render_init_callback_t)(const RenderContext renderCtx, void** user_data);
 typedef void (*render_draw_callback_t)(view_rotation_t rotation, void* user_data);
+typedef void (*render_cleanup_callback_t)(void* user_data);
 
 typedef struct {
   int width;
@@ -57,10 +58,26 @@ typedef struct {
 typedef struct {
   render_init_callback_t initializer;
   render_draw_callback_t draw;
+  render_cleanup_callback_t cleanup;  /* releases the GL objects made by initializer */
+  const void *params;                 /* variant settings, read back in initializer */
 } RenderCallbacks;
 
+typedef struct {
+  int max_frames_in_flight;  /* 0: no limit */
+  int report_latency;
+  float dynres_target_ms;    /* 0: render at window resolution */
+  const char *record_path;
+  const char *replay_path;
+  int replay_fast;           /* replay as fast as possible instead of at recorded pace */
+  int benchmark_frames;      /* 0: wait for events, otherwise draw this many frames */
+  const char *trace_path;    /* Chrome trace event JSON written here at exit */
+  int per_example_files;     /* several examples per run: name.<example>.ext record/replay files */
+} RenderOptions;
+
 typedef struct RenderContext {
+  const char *name;
   window_size_t window_size;
+  RenderOptions options;
   struct {
     Display* display;
     Window window;
@@ -94,10 +111,23 @@ XVisualInfo *get_visual_info(Display *x_dpy, EGLint vid);
 Window x_create_window(const EglInfo egl, Display *x_dpy, window_size_t win_size, const char *name);
 Display *x_open_display(const char* dpyName);
 
+/* Framebuffer and viewport the current frame draws into: the window, or the
+ * scaled offscreen target under -dynres. Tracked on the CPU so nobody has
+ * to glGet them back every frame.
+ */
+typedef struct {
+  GLuint framebuffer;
+  GLint viewport[4];
+} render_view_t;
+
+void render_bind_view(GLuint framebuffer, GLint x, GLint y, GLsizei width, GLsizei height);
+const render_view_t *render_current_view(void);
+
 /* Render helpers */
-void render_event_loop(RenderContext renderCtx, void *user_data);
+void render_event_loop(RenderContext *renderCtx, void *user_data);
 void render_create_context(RenderContext *renderCtx);
 void render_cleanup(RenderContext renderCtx);
-int render_main(int argc, char *argv[], RenderCallbacks callbacks);
+void render_init(int argc, char *argv[], RenderContext *renderCtx);
+void render_run(RenderContext *renderCtx, const char *name, RenderCallbacks callbacks);
 
 #endif /* RENDER_COMMON_H */
@@ -0,0 +1,341 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "render_graph.h"
+
+void render_graph_init(RenderGraph *graph) {
+  memset(graph, 0, sizeof(*graph));
+
+  /* Slot 0 stands for the backbuffer and never gets a texture */
+  graph->resources[RENDER_GRAPH_BACKBUFFER].physical = -1;
+  graph->resource_count = 1;
+}
+
+static void render_graph_release(RenderGraph *graph) {
+  for (int i = 0; i < graph->pass_count; i++) {
+    if (graph->passes[i].fbo) {
+      glDeleteFramebuffers(1, &graph->passes[i].fbo);
+      graph->passes[i].fbo = 0;
+    }
+  }
+  for (int i = 0; i < graph->texture_count; i++) {
+    glDeleteTextures(1, &graph->textures[i].texture);
+  }
+  for (int i = 0; i < graph->depth_count; i++) {
+    glDeleteRenderbuffers(1, &graph->depths[i].renderbuffer);
+  }
+  graph->texture_count = 0;
+  graph->depth_count = 0;
+  graph->compiled = 0;
+}
+
+void render_graph_destroy(RenderGraph *graph) {
+  render_graph_release(graph);
+  memset(graph, 0, sizeof(*graph));
+}
+
+int render_graph_add_resource(RenderGraph *graph, GLenum format, float scale) {
+  assert(graph->resource_count < RENDER_GRAPH_MAX_RESOURCES);
+
+  int id = graph->resource_count++;
+  render_resource_t *resource = &graph->resources[id];
+  memset(resource, 0, sizeof(*resource));
+  resource->format = format;
+  resource->scale = scale;
+  resource->physical = -1;
+  graph->compiled = 0;
+  return id;
+}
+
+RenderPass *render_graph_add_pass(RenderGraph *graph, const char *name,
+                                  render_pass_execute_t execute, void *user_data) {
+  assert(graph->pass_count < RENDER_GRAPH_MAX_PASSES);
+
+  RenderPass *pass = &graph->passes[graph->pass_count++];
+  memset(pass, 0, sizeof(*pass));
+  pass->name = name;
+  pass->execute = execute;
+  pass->user_data = user_data;
+  pass->output = RENDER_GRAPH_BACKBUFFER;
+  pass->load = RENDER_LOAD_KEEP;
+  pass->store = RENDER_STORE_KEEP;
+  graph->compiled = 0;
+  return pass;
+}
+
+void render_pass_read(RenderPass *pass, int resource) {
+  assert(pass->input_count < RENDER_GRAPH_MAX_INPUTS);
+  assert(resource != RENDER_GRAPH_BACKBUFFER);
+  pass->inputs[pass->input_count++] = resource;
+}
+
+void render_pass_write(RenderPass *pass, int resource, enum render_load_op load, enum render_store_op store) {
+  pass->output = resource;
+  pass->load = load;
+  pass->store = store;
+}
+
+static window_size_t render_graph_scaled_size(window_size_t size, float scale) {
+  window_size_t scaled = { (int)(size.width * scale), (int)(size.height * scale) };
+  if (scaled.width < 1) {
+    scaled.width = 1;
+  }
+  if (scaled.height < 1) {
+    scaled.height = 1;
+  }
+  return scaled;
+}
+
+static void render_graph_compute_lifetimes(RenderGraph *graph) {
+  for (int r = 0; r < graph->resource_count; r++) {
+    graph->resources[r].first_use = -1;
+    graph->resources[r].last_use = -1;
+  }
+
+  for (int p = 0; p < graph->pass_count; p++) {
+    RenderPass *pass = &graph->passes[p];
+
+    for (int i = 0; i < pass->input_count; i++) {
+      render_resource_t *input = &graph->resources[pass->inputs[i]];
+      if (input->first_use < 0) {
+        fprintf(stderr, "Error: render pass '%s' reads a resource nobody wrote\n", pass->name);
+        exit(1);
+      }
+      input->last_use = p;
+    }
+
+    if (pass->output != RENDER_GRAPH_BACKBUFFER) {
+      render_resource_t *output = &graph->resources[pass->output];
+      /* One writer per resource: going back to an earlier target would
+       * force a tiler to load it again.
+       */
+      if (output->first_use >= 0) {
+        fprintf(stderr, "Error: render pass '%s' writes a resource a second time\n", pass->name);
+        exit(1);
+      }
+      output->first_use = output->last_use = p;
+
+      /* Aliased memory has no meaningful contents to load */
+      if (pass->load == RENDER_LOAD_KEEP) {
+        pass->load = RENDER_LOAD_DONT_CARE;
+      }
+    }
+  }
+}
+
+static int render_graph_acquire_texture(RenderGraph *graph, int resource_id, int pass_index) {
+  render_resource_t *resource = &graph->resources[resource_id];
+  window_size_t size = render_graph_scaled_size(graph->size, resource->scale);
+
+  for (int i = 0; i < graph->texture_count; i++) {
+    render_texture_t *texture = &graph->textures[i];
+    if (texture->busy_until < pass_index && texture->format == resource->format
+        && texture->size.width == size.width && texture->size.height == size.height) {
+      texture->busy_until = resource->last_use;
+      return i;
+    }
+  }
+
+  assert(graph->texture_count < RENDER_GRAPH_MAX_RESOURCES);
+  render_texture_t *texture = &graph->textures[graph->texture_count];
+  texture->format = resource->format;
+  texture->size = size;
+  texture->busy_until = resource->last_use;
+
+  glGenTextures(1, &texture->texture);
+  glBindTexture(GL_TEXTURE_2D, texture->texture);
+  glTexStorage2D(GL_TEXTURE_2D, 1, texture->format, size.width, size.height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return graph->texture_count++;
+}
+
+static GLuint render_graph_acquire_depth(RenderGraph *graph, window_size_t size) {
+  /* Depth never outlives its pass, one buffer per size is enough */
+  for (int i = 0; i < graph->depth_count; i++) {
+    if (graph->depths[i].size.width == size.width && graph->depths[i].size.height == size.height) {
+      return graph->depths[i].renderbuffer;
+    }
+  }
+
+  render_depth_t *depth = &graph->depths[graph->depth_count++];
+  depth->size = size;
+  glGenRenderbuffers(1, &depth->renderbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth->renderbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.width, size.height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  return depth->renderbuffer;
+}
+
+void render_graph_compile(RenderGraph *graph, window_size_t size) {
+  render_graph_release(graph);
+  graph->size = size;
+
+  render_graph_compute_lifetimes(graph);
+
+  for (int p = 0; p < graph->pass_count; p++) {
+    RenderPass *pass = &graph->passes[p];
+
+    if (pass->output == RENDER_GRAPH_BACKBUFFER) {
+      pass->size = size;
+    } else {
+      render_resource_t *output = &graph->resources[pass->output];
+      output->physical = render_graph_acquire_texture(graph, pass->output, p);
+      pass->size = graph->textures[output->physical].size;
+
+      glGenFramebuffers(1, &pass->fbo);
+      glBindFramebuffer(GL_FRAMEBUFFER, pass->fbo);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                             graph->textures[output->physical].texture, 0);
+      if (pass->use_depth) {
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                  render_graph_acquire_depth(graph, pass->size));
+      }
+
+      GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+      if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Error: render pass '%s' framebuffer incomplete (0x%x)\n", pass->name, status);
+        exit(1);
+      }
+    }
+
+    for (int i = 0; i < pass->input_count; i++) {
+      render_resource_t *input = &graph->resources[pass->inputs[i]];
+      pass->input_textures[i] = graph->textures[input->physical].texture;
+    }
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  graph->compiled = 1;
+}
+
+static void render_pass_run(const RenderPass *pass, GLuint fbo, const GLint *viewport) {
+  GLenum color = fbo ? GL_COLOR_ATTACHMENT0 : GL_COLOR;
+  GLenum depth = fbo ? GL_DEPTH_ATTACHMENT : GL_DEPTH;
+  GLenum stencil = fbo ? GL_STENCIL_ATTACHMENT : GL_STENCIL;
+  GLenum discard[3];
+  int discard_count = 0;
+  GLbitfield clear = 0;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  if (pass->output == RENDER_GRAPH_BACKBUFFER) {
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  } else {
+    glViewport(0, 0, pass->viewport.width, pass->viewport.height);
+  }
+
+  /* Whatever is invalidated or cleared up front needs no tile load */
+  if (pass->load == RENDER_LOAD_CLEAR) {
+    clear |= GL_COLOR_BUFFER_BIT;
+  } else if (pass->load == RENDER_LOAD_DONT_CARE) {
+    discard[discard_count++] = color;
+  }
+  if (pass->use_depth) {
+    clear |= GL_DEPTH_BUFFER_BIT;
+  } else if (pass->output == RENDER_GRAPH_BACKBUFFER) {
+    discard[discard_count++] = depth;
+    discard[discard_count++] = stencil;
+  }
+
+  if (discard_count > 0) {
+    glInvalidateFramebuffer(GL_FRAMEBUFFER, discard_count, discard);
+  }
+  if (clear) {
+    glClearColor(pass->clear_color[0], pass->clear_color[1], pass->clear_color[2], pass->clear_color[3]);
+    glClear(clear);
+  }
+
+  for (int i = 0; i < pass->input_count; i++) {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, pass->input_textures[i]);
+  }
+
+  pass->execute(pass);
+
+  /* And whatever is invalidated afterwards needs no store */
+  discard_count = 0;
+  if (pass->use_depth) {
+    discard[discard_count++] = depth;
+  }
+  if (pass->store == RENDER_STORE_DONT_CARE) {
+    discard[discard_count++] = color;
+  }
+  if (discard_count > 0) {
+    glInvalidateFramebuffer(GL_FRAMEBUFFER, discard_count, discard);
+  }
+
+  for (int i = pass->input_count - 1; i >= 0; i--) {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+}
+
+static int render_graph_bucket(int size, int capacity) {
+  if (size <= capacity) {
+    return capacity;
+  }
+  return (size + RENDER_GRAPH_SIZE_BUCKET - 1) / RENDER_GRAPH_SIZE_BUCKET * RENDER_GRAPH_SIZE_BUCKET;
+}
+
+void render_graph_execute(RenderGraph *graph, GLuint backbuffer, const GLint *viewport) {
+  window_size_t size = { viewport[2], viewport[3] };
+  if (!graph->compiled || size.width > graph->size.width || size.height > graph->size.height) {
+    window_size_t capacity = {
+      render_graph_bucket(size.width, graph->compiled ? graph->size.width : 0),
+      render_graph_bucket(size.height, graph->compiled ? graph->size.height : 0),
+    };
+    render_graph_compile(graph, capacity);
+  }
+
+  for (int p = 0; p < graph->pass_count; p++) {
+    RenderPass *pass = &graph->passes[p];
+
+    if (pass->output == RENDER_GRAPH_BACKBUFFER) {
+      pass->viewport = size;
+    } else {
+      pass->viewport = render_graph_scaled_size(size, graph->resources[pass->output].scale);
+    }
+    for (int i = 0; i < pass->input_count; i++) {
+      const render_resource_t *input = &graph->resources[pass->inputs[i]];
+      window_size_t used = render_graph_scaled_size(size, input->scale);
+      window_size_t allocated = graph->textures[input->physical].size;
+      pass->input_extent[i][0] = (GLfloat)used.width / allocated.width;
+      pass->input_extent[i][1] = (GLfloat)used.height / allocated.height;
+    }
+
+    GLuint fbo = (pass->output == RENDER_GRAPH_BACKBUFFER) ? backbuffer : pass->fbo;
+    render_pass_run(pass, fbo, viewport);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, backbuffer);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
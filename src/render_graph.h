@@ -0,0 +1,139 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <GLES3/gl31.h>
+
+#include "render_common.h"
+
+#define RENDER_GRAPH_MAX_PASSES 16
+#define RENDER_GRAPH_MAX_RESOURCES 16
+#define RENDER_GRAPH_MAX_INPUTS 4
+#define RENDER_GRAPH_SIZE_BUCKET 256
+
+/* Resource id of whatever framebuffer is bound when the graph executes,
+ * normally the window surface.
+ */
+#define RENDER_GRAPH_BACKBUFFER 0
+
+enum render_load_op {
+  RENDER_LOAD_KEEP,       /* previous contents are needed */
+  RENDER_LOAD_CLEAR,
+  RENDER_LOAD_DONT_CARE,  /* every pixel gets overwritten */
+};
+
+enum render_store_op {
+  RENDER_STORE_KEEP,
+  RENDER_STORE_DONT_CARE,
+};
+
+typedef struct RenderPass RenderPass;
+typedef void (*render_pass_execute_t)(const RenderPass *pass);
+
+struct RenderPass {
+  const char *name;
+  render_pass_execute_t execute;
+  void *user_data;  /* for execute, through pass->user_data */
+
+  int inputs[RENDER_GRAPH_MAX_INPUTS];
+  int input_count;
+  int output;
+  int use_depth;  /* transient: cleared before, discarded after the pass */
+  enum render_load_op load;
+  enum render_store_op store;
+  GLfloat clear_color[4];
+
+  /* Filled in by render_graph_compile() */
+  GLuint fbo;
+  GLuint input_textures[RENDER_GRAPH_MAX_INPUTS];
+  window_size_t size;
+
+  /* Filled in by render_graph_execute(): the region drawn this frame, and
+   * the fraction of each input texture it covers, to scale texture
+   * coordinates by.
+   */
+  window_size_t viewport;
+  GLfloat input_extent[RENDER_GRAPH_MAX_INPUTS][2];
+};
+
+typedef struct {
+  GLenum format;
+  float scale;  /* relative to the backbuffer size */
+  int first_use;
+  int last_use;
+  int physical;
+} render_resource_t;
+
+typedef struct {
+  GLuint texture;
+  GLenum format;
+  window_size_t size;
+  int busy_until;  /* last pass using the resource currently aliased here */
+} render_texture_t;
+
+typedef struct {
+  GLuint renderbuffer;
+  window_size_t size;
+} render_depth_t;
+
+/* A small render graph: passes declare what they read and write, and on
+ * compile intermediate textures are pooled so resources with disjoint
+ * lifetimes share memory. Load/store ops turn into clears and
+ * glInvalidateFramebuffer calls, so tiled GPUs skip the memory traffic.
+ */
+typedef struct {
+  RenderPass passes[RENDER_GRAPH_MAX_PASSES];
+  int pass_count;
+  render_resource_t resources[RENDER_GRAPH_MAX_RESOURCES];
+  int resource_count;
+
+  render_texture_t textures[RENDER_GRAPH_MAX_RESOURCES];
+  int texture_count;
+  render_depth_t depths[RENDER_GRAPH_MAX_PASSES];
+  int depth_count;
+
+  window_size_t size;  /* what the textures are allocated for */
+  int compiled;
+} RenderGraph;
+
+void render_graph_init(RenderGraph *graph);
+void render_graph_destroy(RenderGraph *graph);
+
+int render_graph_add_resource(RenderGraph *graph, GLenum format, float scale);
+RenderPass *render_graph_add_pass(RenderGraph *graph, const char *name,
+                                  render_pass_execute_t execute, void *user_data);
+void render_pass_read(RenderPass *pass, int resource);
+void render_pass_write(RenderPass *pass, int resource, enum render_load_op load, enum render_store_op store);
+
+void render_graph_compile(RenderGraph *graph, window_size_t size);
+/* backbuffer and viewport are where the final passes draw, normally from
+ * render_current_view(). Passes render into the part of their targets
+ * matching the viewport. Storage only grows, in RENDER_GRAPH_SIZE_BUCKET
+ * steps, so a viewport that changes every frame (dynamic resolution)
+ * doesn't reallocate anything.
+ */
+void render_graph_execute(RenderGraph *graph, GLuint backbuffer, const GLint *viewport);
+
+#endif /* RENDER_GRAPH_H */
@@ -0,0 +1,155 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "render_target.h"
+
+static void render_target_allocate(RenderTarget *target) {
+  glBindTexture(GL_TEXTURE_2D, target->color);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, target->size.width, target->size.height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glBindRenderbuffer(GL_RENDERBUFFER, target->depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, target->size.width, target->size.height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->color, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target->depth);
+
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    fprintf(stderr, "Error: render target framebuffer incomplete (0x%x)\n", status);
+    exit(1);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void render_target_apply_scale(RenderTarget *target) {
+  target->scaled.width = (int)(target->size.width * target->scale);
+  target->scaled.height = (int)(target->size.height * target->scale);
+  if (target->scaled.width < 1) {
+    target->scaled.width = 1;
+  }
+  if (target->scaled.height < 1) {
+    target->scaled.height = 1;
+  }
+}
+
+void render_target_init(RenderTarget *target, window_size_t size, float target_ms) {
+  memset(target, 0, sizeof(*target));
+  target->size = size;
+  target->scale = 1.0f;
+  target->target_ms = target_ms;
+  target->smoothed_ms = target_ms;
+
+  gpu_timer_init(&target->timer);
+  if (!target->timer.supported) {
+    printf("GL_EXT_disjoint_timer_query not available, resolution stays at full scale\n");
+  }
+
+  glGenFramebuffers(1, &target->fbo);
+  glGenTextures(1, &target->color);
+  glGenRenderbuffers(1, &target->depth);
+  render_target_allocate(target);
+  render_target_apply_scale(target);
+}
+
+void render_target_destroy(RenderTarget *target) {
+  gpu_timer_destroy(&target->timer);
+  glDeleteFramebuffers(1, &target->fbo);
+  glDeleteTextures(1, &target->color);
+  glDeleteRenderbuffers(1, &target->depth);
+  memset(target, 0, sizeof(*target));
+}
+
+void render_target_resize(RenderTarget *target, window_size_t size) {
+  if (size.width == target->size.width && size.height == target->size.height) {
+    return;
+  }
+
+  /* Texture storage is immutable, so resizing means new objects */
+  glDeleteTextures(1, &target->color);
+  glGenTextures(1, &target->color);
+  target->size = size;
+  render_target_allocate(target);
+  render_target_apply_scale(target);
+}
+
+static void render_target_update_scale(RenderTarget *target) {
+  uint64_t elapsed_ns;
+  if (!gpu_timer_collect(&target->timer, &elapsed_ns)) {
+    return;
+  }
+
+  float frame_ms = elapsed_ns / 1e6f;
+  target->smoothed_ms = target->smoothed_ms * 0.8f + frame_ms * 0.2f;
+
+  /* GPU time follows the pixel count, hence the square root. Shrink fast
+   * when over budget, grow slowly and only with some headroom to avoid
+   * oscillating around the target.
+   */
+  float ratio = sqrtf(target->target_ms / target->smoothed_ms);
+  if (target->smoothed_ms > target->target_ms) {
+    target->scale *= fmaxf(ratio, 0.85f);
+  } else if (target->smoothed_ms < target->target_ms * 0.8f) {
+    target->scale *= fminf(ratio, 1.05f);
+  }
+  target->scale = fminf(fmaxf(target->scale, RENDER_TARGET_MIN_SCALE), 1.0f);
+
+  render_target_apply_scale(target);
+}
+
+void render_target_begin(RenderTarget *target) {
+  render_target_update_scale(target);
+
+  render_bind_view(target->fbo, 0, 0, target->scaled.width, target->scaled.height);
+  gpu_timer_begin(&target->timer);
+}
+
+void render_target_end(RenderTarget *target) {
+  static const GLenum depth_attachment[] = { GL_DEPTH_ATTACHMENT };
+  static const GLenum color_attachment[] = { GL_COLOR_ATTACHMENT0 };
+
+  gpu_timer_end(&target->timer);
+
+  /* Depth is never read back, don't let a tiler write it to memory */
+  glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, depth_attachment);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glBlitFramebuffer(0, 0, target->scaled.width, target->scaled.height,
+                    0, 0, target->size.width, target->size.height,
+                    GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+  /* Fully consumed by the blit */
+  glInvalidateFramebuffer(GL_READ_FRAMEBUFFER, 1, color_attachment);
+
+  render_bind_view(0, 0, 0, target->size.width, target->size.height);
+}
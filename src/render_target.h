@@ -0,0 +1,59 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <GLES3/gl31.h>
+
+#include "gpu_timer.h"
+#include "render_common.h"
+
+#define RENDER_TARGET_MIN_SCALE 0.25f
+
+/* Offscreen target whose rendered resolution follows the measured GPU time.
+ * Storage is allocated at window size and only a scaled sub-rectangle is
+ * drawn, so changing the scale never reallocates; the region is upscaled
+ * to the window with a linear blit.
+ */
+typedef struct {
+  GLuint fbo;
+  GLuint color;
+  GLuint depth;
+  window_size_t size;
+  window_size_t scaled;
+
+  float scale;
+  float target_ms;
+  float smoothed_ms;
+  GpuTimer timer;
+} RenderTarget;
+
+void render_target_init(RenderTarget *target, window_size_t size, float target_ms);
+void render_target_destroy(RenderTarget *target);
+void render_target_resize(RenderTarget *target, window_size_t size);
+
+void render_target_begin(RenderTarget *target);
+void render_target_end(RenderTarget *target);
+
+#endif /* RENDER_TARGET_H */
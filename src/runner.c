@@ -0,0 +1,107 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "example_registry.h"
+#include "render_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Runs registered examples one after the other in a single window and GL
+ * context. Built with EXAMPLE_NAME it is that example's standalone binary.
+ */
+
+static const ExampleDesc *runner_find(const char *name) {
+  const ExampleDesc *desc = example_find(name);
+  if (!desc) {
+    fprintf(stderr, "Error: unknown example %s, see -list\n", name);
+    exit(1);
+  }
+  return desc;
+}
+
+#ifndef EXAMPLE_NAME
+static void runner_usage(void) {
+  printf("Runner options:\n");
+  printf("  -list                   list the registered examples\n");
+  printf("  -example <name>         run the named example, may be repeated\n");
+  printf("  -all                    run every example in turn (default)\n");
+  printf("Each example runs until escape, or for n frames with -benchmark <n>\n");
+}
+#endif
+
+int main(int argc, char *argv[]) {
+  const ExampleDesc *selected[EXAMPLE_MAX];
+  int selected_count = 0;
+
+#ifdef EXAMPLE_NAME
+  selected[selected_count++] = runner_find(EXAMPLE_NAME);
+#else
+  /* Take out the runner's own options, the rest goes to render_init */
+  int render_argc = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-list") == 0) {
+      for (int e = 0; e < example_count(); e++) {
+        printf("%s\n", example_get(e)->name);
+      }
+      return 0;
+    } else if (strcmp(argv[i], "-example") == 0 && i + 1 < argc) {
+      if (selected_count == EXAMPLE_MAX) {
+        fprintf(stderr, "Error: too many examples selected\n");
+        exit(1);
+      }
+      selected[selected_count++] = runner_find(argv[i + 1]);
+      i++;
+    } else if (strcmp(argv[i], "-all") == 0) {
+      selected_count = 0;
+    } else if (strcmp(argv[i], "-help") == 0) {
+      runner_usage();
+      return 0;
+    } else {
+      argv[render_argc++] = argv[i];
+    }
+  }
+  argc = render_argc;
+
+  if (selected_count == 0) {
+    for (int e = 0; e < example_count(); e++) {
+      selected[selected_count++] = example_get(e);
+    }
+  }
+#endif
+
+  RenderContext renderCtx;
+  render_init(argc, argv, &renderCtx);
+  renderCtx.options.per_example_files = (selected_count > 1);
+
+  for (int i = 0; i < selected_count; i++) {
+    if (selected_count > 1) {
+      printf("== %s ==\n", selected[i]->name);
+    }
+    render_run(&renderCtx, selected[i]->name, selected[i]->callbacks);
+  }
+
+  render_cleanup(renderCtx);
+  return 0;
+}
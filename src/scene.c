@@ -0,0 +1,343 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix.h"
+#include "scene.h"
+
+#define SCENE_NODE_DIRTY    0x1
+#define SCENE_NODE_UPDATED  0x2
+
+/* Below this many nodes the threads cost more than they save */
+#define SCENE_THREADED_MIN_NODES 4096
+
+static void *scene_realloc(void *ptr, size_t size) {
+  void *result = realloc(ptr, size);
+  if (!result) {
+    fprintf(stderr, "Error: out of memory for scene graph (%zu bytes)\n", size);
+    exit(1);
+  }
+  return result;
+}
+
+static void scene_graph_reserve(SceneGraph *graph, int capacity) {
+  if (capacity <= graph->capacity) {
+    return;
+  }
+
+  graph->parent = scene_realloc(graph->parent, sizeof(int) * capacity);
+  graph->depth = scene_realloc(graph->depth, sizeof(int) * capacity);
+  graph->level_order = scene_realloc(graph->level_order, sizeof(int) * capacity);
+  graph->flags = scene_realloc(graph->flags, sizeof(unsigned char) * capacity);
+  graph->local = scene_realloc(graph->local, sizeof(GLfloat) * 16 * capacity);
+  graph->world = scene_realloc(graph->world, sizeof(GLfloat) * 16 * capacity);
+  graph->capacity = capacity;
+}
+
+void scene_graph_init(SceneGraph *graph, int capacity) {
+  assert(graph != 0);
+  memset(graph, 0, sizeof(*graph));
+  scene_graph_reserve(graph, capacity > 0 ? capacity : 16);
+}
+
+static void scene_graph_stop_workers(SceneGraph *graph);
+
+void scene_graph_destroy(SceneGraph *graph) {
+  scene_graph_stop_workers(graph);
+  free(graph->parent);
+  free(graph->depth);
+  free(graph->level_order);
+  free(graph->level_start);
+  free(graph->flags);
+  free(graph->local);
+  free(graph->world);
+  memset(graph, 0, sizeof(*graph));
+}
+
+int scene_graph_add_node(SceneGraph *graph, int parent, const GLfloat *local) {
+  /* Parents must already exist, which keeps the arrays in parent-before-child order */
+  assert(parent == SCENE_NO_PARENT || (parent >= 0 && parent < graph->count));
+
+  if (graph->count == graph->capacity) {
+    scene_graph_reserve(graph, graph->capacity * 2);
+  }
+
+  int node = graph->count++;
+  graph->parent[node] = parent;
+  graph->depth[node] = (parent == SCENE_NO_PARENT) ? 0 : graph->depth[parent] + 1;
+  graph->flags[node] = SCENE_NODE_DIRTY;
+  graph->dirty_count++;
+  graph->schedule_valid = 0;
+
+  if (local) {
+    memcpy(&graph->local[node * 16], local, sizeof(GLfloat) * 16);
+  } else {
+    matrix_make_identity(&graph->local[node * 16]);
+  }
+
+  return node;
+}
+
+void scene_graph_set_local(SceneGraph *graph, int node, const GLfloat *local) {
+  assert(node >= 0 && node < graph->count);
+  memcpy(&graph->local[node * 16], local, sizeof(GLfloat) * 16);
+
+  if (!(graph->flags[node] & SCENE_NODE_DIRTY)) {
+    graph->flags[node] |= SCENE_NODE_DIRTY;
+    graph->dirty_count++;
+  }
+}
+
+const GLfloat *scene_graph_world(const SceneGraph *graph, int node) {
+  assert(node >= 0 && node < graph->count);
+  return &graph->world[node * 16];
+}
+
+static int scene_node_update(SceneGraph *graph, int node) {
+  int parent = graph->parent[node];
+  int changed = (graph->flags[node] & SCENE_NODE_DIRTY)
+             || (parent != SCENE_NO_PARENT && (graph->flags[parent] & SCENE_NODE_UPDATED));
+
+  if (!changed) {
+    /* Also drops the UPDATED mark left over from an earlier pass */
+    graph->flags[node] = 0;
+    return 0;
+  }
+
+  GLfloat *world = &graph->world[node * 16];
+  const GLfloat *local = &graph->local[node * 16];
+  if (parent == SCENE_NO_PARENT) {
+    memcpy(world, local, sizeof(GLfloat) * 16);
+  } else {
+    matrix_mul(world, &graph->world[parent * 16], local);
+  }
+
+  graph->flags[node] = SCENE_NODE_UPDATED;
+  return 1;
+}
+
+int scene_graph_update(SceneGraph *graph) {
+  if (graph->dirty_count == 0) {
+    return 0;
+  }
+
+  int updated = 0;
+  for (int i = 0; i < graph->count; i++) {
+    updated += scene_node_update(graph, i);
+  }
+
+  graph->dirty_count = 0;
+  return updated;
+}
+
+static void scene_graph_build_schedule(SceneGraph *graph) {
+  int max_depth = 0;
+  for (int i = 0; i < graph->count; i++) {
+    if (graph->depth[i] > max_depth) {
+      max_depth = graph->depth[i];
+    }
+  }
+
+  graph->level_count = max_depth + 1;
+  graph->level_start = scene_realloc(graph->level_start, sizeof(int) * (graph->level_count + 1));
+  memset(graph->level_start, 0, sizeof(int) * (graph->level_count + 1));
+
+  /* Counting sort by depth: nodes of one level only depend on earlier levels */
+  for (int i = 0; i < graph->count; i++) {
+    graph->level_start[graph->depth[i] + 1]++;
+  }
+  for (int level = 0; level < graph->level_count; level++) {
+    graph->level_start[level + 1] += graph->level_start[level];
+  }
+
+  int *fill = scene_realloc(NULL, sizeof(int) * graph->level_count);
+  memcpy(fill, graph->level_start, sizeof(int) * graph->level_count);
+  for (int i = 0; i < graph->count; i++) {
+    graph->level_order[fill[graph->depth[i]]++] = i;
+  }
+  free(fill);
+
+  graph->schedule_valid = 1;
+}
+
+struct SceneWorker {
+  SceneGraph *graph;
+  int index;
+  int updated;
+};
+
+/* Worker threads live as long as the graph; each update bumps the
+ * generation to release them for one level-by-level pass */
+struct ScenePool {
+  int num_threads;
+  pthread_t *threads;
+  struct SceneWorker *workers;
+  pthread_barrier_t barrier;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  unsigned generation;
+  int stop;
+};
+
+static void scene_worker_pass(struct SceneWorker *worker) {
+  SceneGraph *graph = worker->graph;
+  struct ScenePool *pool = graph->pool;
+
+  /* Once past the last barrier the updating thread may already be changing
+   * the graph (adding nodes rebuilds the schedule), so nothing of it can be
+   * read after that: take what the loop needs up front.
+   */
+  const int level_count = graph->level_count;
+  const int *level_start = graph->level_start;
+  const int *level_order = graph->level_order;
+  const int num_threads = pool->num_threads;
+  pthread_barrier_t *barrier = &pool->barrier;
+
+  for (int level = 0; level < level_count; level++) {
+    int first = level_start[level];
+    int size = level_start[level + 1] - first;
+    int begin = first + (int)((long)size * worker->index / num_threads);
+    int end = first + (int)((long)size * (worker->index + 1) / num_threads);
+
+    for (int i = begin; i < end; i++) {
+      worker->updated += scene_node_update(graph, level_order[i]);
+    }
+
+    /* Children in the next level read the flags/world written here */
+    pthread_barrier_wait(barrier);
+  }
+}
+
+static void *scene_worker_run(void *arg) {
+  struct SceneWorker *worker = (struct SceneWorker*)arg;
+  struct ScenePool *pool = worker->graph->pool;
+  unsigned seen = 0;
+
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->generation == seen && !pool->stop) {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+    seen = pool->generation;
+    int stop = pool->stop;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (stop) {
+      return NULL;
+    }
+    scene_worker_pass(worker);
+  }
+}
+
+void scene_graph_start_workers(SceneGraph *graph, int num_threads) {
+  if (graph->pool || num_threads <= 1) {
+    return;
+  }
+
+  struct ScenePool *pool = scene_realloc(NULL, sizeof(struct ScenePool));
+  memset(pool, 0, sizeof(*pool));
+  pool->num_threads = num_threads;
+  pool->threads = scene_realloc(NULL, sizeof(pthread_t) * num_threads);
+  pool->workers = scene_realloc(NULL, sizeof(struct SceneWorker) * num_threads);
+  pthread_barrier_init(&pool->barrier, NULL, num_threads);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  graph->pool = pool;
+
+  for (int i = 0; i < num_threads; i++) {
+    pool->workers[i].graph = graph;
+    pool->workers[i].index = i;
+    pool->workers[i].updated = 0;
+  }
+
+  /* The updating thread takes the first share itself */
+  for (int i = 1; i < num_threads; i++) {
+    if (pthread_create(&pool->threads[i], NULL, scene_worker_run, &pool->workers[i]) != 0) {
+      fprintf(stderr, "Error: couldn't create scene update thread\n");
+      exit(1);
+    }
+  }
+}
+
+static void scene_graph_stop_workers(SceneGraph *graph) {
+  struct ScenePool *pool = graph->pool;
+  if (!pool) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 1; i < pool->num_threads; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&pool->wake);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_barrier_destroy(&pool->barrier);
+  free(pool->workers);
+  free(pool->threads);
+  free(pool);
+  graph->pool = NULL;
+}
+
+int scene_graph_update_threaded(SceneGraph *graph) {
+  struct ScenePool *pool = graph->pool;
+
+  if (!pool || graph->count < SCENE_THREADED_MIN_NODES) {
+    return scene_graph_update(graph);
+  }
+  if (graph->dirty_count == 0) {
+    return 0;
+  }
+  if (!graph->schedule_valid) {
+    scene_graph_build_schedule(graph);
+  }
+
+  for (int i = 0; i < pool->num_threads; i++) {
+    pool->workers[i].updated = 0;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->generation++;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  /* Past the last level's barrier every worker is done with this pass */
+  scene_worker_pass(&pool->workers[0]);
+
+  int updated = 0;
+  for (int i = 0; i < pool->num_threads; i++) {
+    updated += pool->workers[i].updated;
+  }
+
+  graph->dirty_count = 0;
+  return updated;
+}
@@ -0,0 +1,72 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <GLES3/gl31.h>
+
+#define SCENE_NO_PARENT (-1)
+
+/* Hierarchical transforms stored as flat arrays in parent-before-child order.
+ * Only nodes marked dirty (and their descendants) get their world matrix
+ * recomputed by an update pass; a pass with nothing dirty is free.
+ */
+struct ScenePool;
+
+typedef struct {
+  int count;
+  int capacity;
+  int dirty_count;
+  int *parent;
+  unsigned char *flags;
+  GLfloat *local;   /* 16 floats per node, column-major */
+  GLfloat *world;   /* 16 floats per node, column-major */
+
+  /* Breadth-first schedule for the threaded update, rebuilt on demand */
+  int *depth;
+  int *level_order;
+  int *level_start;
+  int level_count;
+  int schedule_valid;
+  struct ScenePool *pool;  /* worker threads, see scene_graph_start_workers */
+} SceneGraph;
+
+void scene_graph_init(SceneGraph *graph, int capacity);
+void scene_graph_destroy(SceneGraph *graph);
+
+int scene_graph_add_node(SceneGraph *graph, int parent, const GLfloat *local);
+void scene_graph_set_local(SceneGraph *graph, int node, const GLfloat *local);
+const GLfloat *scene_graph_world(const SceneGraph *graph, int node);
+
+/* Starts num_threads - 1 workers that stay parked until scene_graph_destroy,
+ * the thread calling scene_graph_update_threaded is the last one */
+void scene_graph_start_workers(SceneGraph *graph, int num_threads);
+
+/* Both return the number of nodes whose world matrix was recomputed. The
+ * threaded one falls back to the serial pass without workers or for small
+ * graphs. */
+int scene_graph_update(SceneGraph *graph);
+int scene_graph_update_threaded(SceneGraph *graph);
+
+#endif /* SCENE_H */
@@ -26,17 +26,20 @@
 #include <stdio.h>
 
 #include "shaders.h"
+#include "trace.h"
 
 static const char* shader_type_str(GLenum type) {
   switch(type) {
     case GL_FRAGMENT_SHADER: return "Fragment";
     case GL_VERTEX_SHADER: return "Vertex";
+    case GL_COMPUTE_SHADER: return "Compute";
     default:
       return "<Unknown Shader type>";
   }
 }
 
 static GLuint shader_create(GLenum type, const char* src) {
+  TRACE_SCOPE("shader_compile");
   GLint shader = glCreateShader(type);
   glShaderSource(shader, 1, (const char **) &src, NULL);
   glCompileShader(shader);
@@ -62,15 +65,7 @@ static GLuint shader_create(GLenum type, const char* src) {
   return shader;
 }
 
-GLuint shader_program_create(const char *vertex_src, const char *fragment_src) {
-  GLuint fragment_shader = shader_create(GL_FRAGMENT_SHADER, fragment_src);
-  GLuint vertex_shader = shader_create(GL_VERTEX_SHADER, vertex_src);
-
-  GLint program = glCreateProgram();
-  glAttachShader(program, fragment_shader);
-  glAttachShader(program, vertex_shader);
-  glLinkProgram(program);
-
+static void shader_program_check_link(GLuint program, const char *shaders_desc) {
   GLint stat = 0;
 
   glGetProgramiv(program, GL_LINK_STATUS, &stat);
@@ -81,11 +76,41 @@ GLuint shader_program_create(const char *vertex_src, const char *fragment_src) {
 
     char *error_log = (char*)malloc(sizeof(char) * (required_length + 1));
     glGetProgramInfoLog(program, required_length, NULL, error_log);
-    fprintf(stderr, "Error: linking shaders(%d, %d)\n", vertex_shader, fragment_shader);
+    fprintf(stderr, "Error: linking shaders(%s)\n", shaders_desc);
     fprintf(stderr, "Error returned:\n%s\n", error_log);
     free(error_log);
     exit(1);
   }
+}
+
+GLuint shader_program_create(const char *vertex_src, const char *fragment_src) {
+  TRACE_SCOPE("shader_program_create");
+  GLuint fragment_shader = shader_create(GL_FRAGMENT_SHADER, fragment_src);
+  GLuint vertex_shader = shader_create(GL_VERTEX_SHADER, vertex_src);
+
+  GLint program = glCreateProgram();
+  glAttachShader(program, fragment_shader);
+  glAttachShader(program, vertex_shader);
+  glLinkProgram(program);
+
+  char shaders_desc[32];
+  snprintf(shaders_desc, sizeof(shaders_desc), "%d, %d", vertex_shader, fragment_shader);
+  shader_program_check_link(program, shaders_desc);
+
+  return program;
+}
+
+GLuint shader_compute_program_create(const char *compute_src) {
+  TRACE_SCOPE("shader_compute_program_create");
+  GLuint compute_shader = shader_create(GL_COMPUTE_SHADER, compute_src);
+
+  GLint program = glCreateProgram();
+  glAttachShader(program, compute_shader);
+  glLinkProgram(program);
+
+  char shaders_desc[32];
+  snprintf(shaders_desc, sizeof(shaders_desc), "%d", compute_shader);
+  shader_program_check_link(program, shaders_desc);
 
   return program;
 }
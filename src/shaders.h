@@ -29,6 +29,7 @@
 #define SHADER_GLSLV(VERSION, SHADER) "#version " #VERSION " es\n" #SHADER
 
 GLuint shader_program_create(const char *vertex_src, const char *fragment_src);
+GLuint shader_compute_program_create(const char *compute_src);
 
 enum shader_select {
   SHADER_VERTEX_MVP,
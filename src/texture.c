@@ -0,0 +1,447 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ktx.h"
+#include "texture.h"
+#include "trace.h"
+
+enum texture_source {
+  TEXTURE_SOURCE_KTX,
+  TEXTURE_SOURCE_RGBA,
+};
+
+struct TextureRequest {
+  enum texture_source source;
+  char *path;
+  int width;
+  int height;
+  StreamedTexture *texture;
+  struct TextureRequest *next;
+};
+
+/* One mip level ready for upload, or a failure notice when data is NULL */
+struct TextureLevel {
+  StreamedTexture *texture;
+  GLenum internal_format;
+  GLenum format;  /* 0 for compressed data */
+  GLenum type;
+  int base_width;
+  int base_height;
+  int levels;
+  int level;
+  int width;
+  int height;
+  size_t size;
+  unsigned char *data;
+  struct TextureLevel *next;
+};
+
+struct TextureEntry {
+  StreamedTexture texture;
+  struct TextureEntry *next;
+};
+
+struct TextureStreamer {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  int stop;
+  int outstanding;  /* requests not yet turned into levels */
+
+  struct TextureRequest *requests;
+  struct TextureRequest *requests_tail;
+  struct TextureLevel *ready;
+  struct TextureLevel *ready_tail;
+
+  struct TextureEntry *textures;
+  GLuint pbo;
+  size_t frame_budget;
+};
+
+static void *texture_alloc(size_t size) {
+  void *result = malloc(size);
+  if (!result) {
+    fprintf(stderr, "Error: out of memory for texture streaming (%zu bytes)\n", size);
+    exit(1);
+  }
+  return result;
+}
+
+static unsigned char *texture_read_file(const char *path, size_t *size) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "Error: couldn't open texture %s\n", path);
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  unsigned char *data = NULL;
+  if (length > 0) {
+    data = texture_alloc(length);
+    if (fread(data, 1, length, file) != (size_t)length) {
+      fprintf(stderr, "Error: couldn't read texture %s\n", path);
+      free(data);
+      data = NULL;
+    }
+  }
+  fclose(file);
+
+  *size = (size_t)length;
+  return data;
+}
+
+/* Called with the lock held */
+static void texture_push_level(TextureStreamer *streamer, struct TextureLevel *level) {
+  level->next = NULL;
+  if (streamer->ready_tail) {
+    streamer->ready_tail->next = level;
+  } else {
+    streamer->ready = level;
+  }
+  streamer->ready_tail = level;
+}
+
+static struct TextureLevel *texture_level_new(const struct TextureRequest *request) {
+  struct TextureLevel *level = texture_alloc(sizeof(struct TextureLevel));
+  memset(level, 0, sizeof(*level));
+  level->texture = request->texture;
+  return level;
+}
+
+/* Splits a KTX file into levels ordered smallest first.
+ * Returns the number of levels or 0 if the file is not usable.
+ */
+static int texture_parse_ktx(const struct TextureRequest *request, const unsigned char *file, size_t size,
+                             struct TextureLevel **levels_out) {
+  KtxImage image;
+  const char *error = ktx_parse(file, size, &image);
+  if (error) {
+    fprintf(stderr, "Error: %s: %s\n", request->path, error);
+    return 0;
+  }
+
+  for (int i = 0; i < image.levels; i++) {
+    struct TextureLevel *level = texture_level_new(request);
+    level->internal_format = image.internal_format;
+    level->format = image.format;
+    level->type = image.type;
+    level->base_width = image.width;
+    level->base_height = image.height;
+    level->levels = image.levels;
+    level->level = i;
+    level->width = (image.width >> i) ? (image.width >> i) : 1;
+    level->height = (image.height >> i) ? (image.height >> i) : 1;
+    level->size = image.level_size[i];
+    level->data = texture_alloc(level->size ? level->size : 1);
+    memcpy(level->data, file + image.level_offset[i], level->size);
+
+    /* Lowest resolution first, so something is visible as early as possible */
+    levels_out[image.levels - 1 - i] = level;
+  }
+  return image.levels;
+}
+
+static void texture_load(TextureStreamer *streamer, struct TextureRequest *request) {
+  size_t size = 0;
+  unsigned char *file = texture_read_file(request->path, &size);
+
+  /* Enough room for every level a 2D texture can have */
+  struct TextureLevel *levels[KTX_MAX_LEVELS];
+  int level_count = 0;
+
+  if (file && request->source == TEXTURE_SOURCE_KTX) {
+    level_count = texture_parse_ktx(request, file, size, levels);
+    free(file);
+  } else if (file && request->source == TEXTURE_SOURCE_RGBA) {
+    size_t expected = (size_t)request->width * request->height * 4;
+    if (size != expected) {
+      fprintf(stderr, "Error: %s: expected %zu bytes of RGBA data, got %zu\n", request->path, expected, size);
+      free(file);
+    } else {
+      struct TextureLevel *level = texture_level_new(request);
+      level->internal_format = GL_RGBA8;
+      level->format = GL_RGBA;
+      level->type = GL_UNSIGNED_BYTE;
+      level->base_width = level->width = request->width;
+      level->base_height = level->height = request->height;
+      level->levels = 1;
+      level->size = size;
+      level->data = file;
+      levels[level_count++] = level;
+    }
+  }
+
+  if (level_count == 0) {
+    /* Failure notice, so the GL thread can mark the texture */
+    levels[level_count++] = texture_level_new(request);
+  }
+
+  pthread_mutex_lock(&streamer->lock);
+  for (int i = 0; i < level_count; i++) {
+    texture_push_level(streamer, levels[i]);
+  }
+  streamer->outstanding--;
+  pthread_mutex_unlock(&streamer->lock);
+}
+
+static void *texture_worker_run(void *arg) {
+  TextureStreamer *streamer = (TextureStreamer*)arg;
+  trace_thread_name("texture streamer");
+
+  pthread_mutex_lock(&streamer->lock);
+  while (!streamer->stop) {
+    struct TextureRequest *request = streamer->requests;
+    if (!request) {
+      pthread_cond_wait(&streamer->wake, &streamer->lock);
+      continue;
+    }
+
+    streamer->requests = request->next;
+    if (!streamer->requests) {
+      streamer->requests_tail = NULL;
+    }
+    pthread_mutex_unlock(&streamer->lock);
+
+    {
+      TRACE_SCOPE("texture_load");
+      texture_load(streamer, request);
+    }
+    free(request->path);
+    free(request);
+
+    pthread_mutex_lock(&streamer->lock);
+  }
+  pthread_mutex_unlock(&streamer->lock);
+
+  return NULL;
+}
+
+TextureStreamer *texture_streamer_create(size_t frame_budget) {
+  TextureStreamer *streamer = texture_alloc(sizeof(TextureStreamer));
+  memset(streamer, 0, sizeof(*streamer));
+  streamer->frame_budget = frame_budget;
+
+  pthread_mutex_init(&streamer->lock, NULL);
+  pthread_cond_init(&streamer->wake, NULL);
+  glGenBuffers(1, &streamer->pbo);
+
+  if (pthread_create(&streamer->thread, NULL, texture_worker_run, streamer) != 0) {
+    fprintf(stderr, "Error: couldn't create texture streaming thread\n");
+    exit(1);
+  }
+
+  return streamer;
+}
+
+void texture_streamer_destroy(TextureStreamer *streamer) {
+  pthread_mutex_lock(&streamer->lock);
+  streamer->stop = 1;
+  pthread_cond_signal(&streamer->wake);
+  pthread_mutex_unlock(&streamer->lock);
+  pthread_join(streamer->thread, NULL);
+
+  while (streamer->requests) {
+    struct TextureRequest *request = streamer->requests;
+    streamer->requests = request->next;
+    free(request->path);
+    free(request);
+  }
+  while (streamer->ready) {
+    struct TextureLevel *level = streamer->ready;
+    streamer->ready = level->next;
+    free(level->data);
+    free(level);
+  }
+  while (streamer->textures) {
+    struct TextureEntry *entry = streamer->textures;
+    streamer->textures = entry->next;
+    glDeleteTextures(1, &entry->texture.id);
+    free(entry);
+  }
+
+  glDeleteBuffers(1, &streamer->pbo);
+  pthread_cond_destroy(&streamer->wake);
+  pthread_mutex_destroy(&streamer->lock);
+  free(streamer);
+}
+
+static StreamedTexture *texture_request(TextureStreamer *streamer, enum texture_source source,
+                                        const char *path, int width, int height) {
+  struct TextureEntry *entry = texture_alloc(sizeof(struct TextureEntry));
+  memset(entry, 0, sizeof(*entry));
+  entry->texture.state = TEXTURE_PENDING;
+  entry->next = streamer->textures;
+  streamer->textures = entry;
+
+  struct TextureRequest *request = texture_alloc(sizeof(struct TextureRequest));
+  request->source = source;
+  request->path = texture_alloc(strlen(path) + 1);
+  strcpy(request->path, path);
+  request->width = width;
+  request->height = height;
+  request->texture = &entry->texture;
+  request->next = NULL;
+
+  pthread_mutex_lock(&streamer->lock);
+  if (streamer->requests_tail) {
+    streamer->requests_tail->next = request;
+  } else {
+    streamer->requests = request;
+  }
+  streamer->requests_tail = request;
+  streamer->outstanding++;
+  pthread_cond_signal(&streamer->wake);
+  pthread_mutex_unlock(&streamer->lock);
+
+  return &entry->texture;
+}
+
+StreamedTexture *texture_stream_ktx(TextureStreamer *streamer, const char *path) {
+  return texture_request(streamer, TEXTURE_SOURCE_KTX, path, 0, 0);
+}
+
+StreamedTexture *texture_stream_rgba(TextureStreamer *streamer, const char *path, int width, int height) {
+  assert(width > 0 && height > 0);
+  return texture_request(streamer, TEXTURE_SOURCE_RGBA, path, width, height);
+}
+
+static void texture_upload_level(TextureStreamer *streamer, struct TextureLevel *level) {
+  StreamedTexture *texture = level->texture;
+
+  if (!level->data) {
+    texture->state = TEXTURE_FAILED;
+    return;
+  }
+  if (texture->state == TEXTURE_FAILED) {
+    return;  /* an earlier level didn't make it, the rest can't be shown */
+  }
+
+  /* Errors raised before this point belong to someone else (bounded: a
+   * lost context may keep reporting)
+   */
+  for (int i = 0; i < 8 && glGetError() != GL_NO_ERROR; i++) {
+    ;
+  }
+
+  if (!texture->id) {
+    texture->internal_format = level->internal_format;
+    texture->width = level->base_width;
+    texture->height = level->base_height;
+    texture->levels = level->levels;
+    texture->finest_level = level->levels;
+
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glTexStorage2D(GL_TEXTURE_2D, texture->levels, texture->internal_format, texture->width, texture->height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture->levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->levels - 1);
+  } else {
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+  }
+
+  /* Orphan the previous contents so the driver never waits on an upload still in flight */
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamer->pbo);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, level->size, NULL, GL_STREAM_DRAW);
+  void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, level->size,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (mapped) {
+    memcpy(mapped, level->data, level->size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  } else {
+    glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, level->size, level->data);
+  }
+
+  if (level->format == 0) {
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, level->level, 0, 0, level->width, level->height,
+                              level->internal_format, level->size, (const GLvoid*)0);
+  } else {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, level->level, 0, 0, level->width, level->height,
+                    level->format, level->type, (const GLvoid*)0);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  /* A level the driver refused leaves a hole, so don't expose it or anything finer */
+  GLenum error = glGetError();
+  if (error != GL_NO_ERROR) {
+    fprintf(stderr, "Error: uploading level %d of a streamed texture failed (0x%x)\n", level->level, error);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    texture->state = TEXTURE_FAILED;
+    return;
+  }
+
+  /* Levels come smallest first, so everything from here down is valid */
+  texture->finest_level = level->level;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture->finest_level);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  texture->state = (texture->finest_level == 0) ? TEXTURE_COMPLETE : TEXTURE_PARTIAL;
+}
+
+size_t texture_streamer_pump(TextureStreamer *streamer) {
+  size_t uploaded = 0;
+
+  while (1) {
+    pthread_mutex_lock(&streamer->lock);
+    struct TextureLevel *level = streamer->ready;
+    if (level && uploaded > 0 && uploaded + level->size > streamer->frame_budget) {
+      level = NULL;  /* out of budget, the rest waits for the next frame */
+    }
+    if (level) {
+      streamer->ready = level->next;
+      if (!streamer->ready) {
+        streamer->ready_tail = NULL;
+      }
+    }
+    pthread_mutex_unlock(&streamer->lock);
+
+    if (!level) {
+      break;
+    }
+
+    texture_upload_level(streamer, level);
+    uploaded += level->size;
+    free(level->data);
+    free(level);
+  }
+
+  return uploaded;
+}
+
+int texture_streamer_busy(TextureStreamer *streamer) {
+  pthread_mutex_lock(&streamer->lock);
+  int busy = streamer->outstanding > 0 || streamer->ready != NULL;
+  pthread_mutex_unlock(&streamer->lock);
+  return busy;
+}
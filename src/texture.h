@@ -0,0 +1,67 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stddef.h>
+#include <GLES3/gl31.h>
+
+typedef enum {
+  TEXTURE_PENDING,   /* nothing uploaded yet */
+  TEXTURE_PARTIAL,   /* some of the smaller mip levels are usable */
+  TEXTURE_COMPLETE,  /* every level uploaded */
+  TEXTURE_FAILED,
+} texture_state_t;
+
+/* A texture filled in over several frames. Levels arrive smallest first and
+ * GL_TEXTURE_BASE_LEVEL tracks the finest uploaded one, so the texture can
+ * be sampled as soon as it is PARTIAL.
+ */
+typedef struct {
+  GLuint id;
+  GLenum internal_format;
+  int width;
+  int height;
+  int levels;
+  int finest_level;
+  texture_state_t state;
+} StreamedTexture;
+
+typedef struct TextureStreamer TextureStreamer;
+
+/* Files are read and parsed on a background thread, uploads happen in
+ * texture_streamer_pump() on the GL thread through a pixel unpack buffer,
+ * at most frame_budget bytes per call (a single oversized level still goes).
+ */
+TextureStreamer *texture_streamer_create(size_t frame_budget);
+void texture_streamer_destroy(TextureStreamer *streamer);
+size_t texture_streamer_pump(TextureStreamer *streamer);
+int texture_streamer_busy(TextureStreamer *streamer);
+
+/* KTX 1.1 files with ETC2/EAC or uncompressed 2D data */
+StreamedTexture *texture_stream_ktx(TextureStreamer *streamer, const char *path);
+/* Tightly packed 8 bit RGBA without header */
+StreamedTexture *texture_stream_rgba(TextureStreamer *streamer, const char *path, int width, int height);
+
+#endif /* TEXTURE_H */
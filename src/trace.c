@@ -0,0 +1,203 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+
+#define TRACE_GPU_TID 0
+
+typedef struct {
+  const char *name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+  enum trace_track track;
+} TraceEvent;
+
+typedef struct TraceBuffer {
+  struct TraceBuffer *next;
+  int tid;
+  const char *thread_name;
+  TraceEvent *events;
+  int count;
+  int capacity;
+} TraceBuffer;
+
+int trace_enabled = 0;
+
+static const char *trace_path;
+static uint64_t trace_start_ns;
+
+/* The lock only guards the list of buffers, events go to the thread's own */
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceBuffer *trace_buffers;
+static int trace_next_tid = 1;
+static __thread TraceBuffer *trace_local;
+
+uint64_t trace_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static TraceBuffer *trace_thread_buffer(void) {
+  if (!trace_local) {
+    TraceBuffer *buffer = calloc(1, sizeof(TraceBuffer));
+    if (!buffer) {
+      fprintf(stderr, "Error: out of memory for trace buffer\n");
+      exit(1);
+    }
+
+    pthread_mutex_lock(&trace_lock);
+    buffer->tid = trace_next_tid++;
+    buffer->next = trace_buffers;
+    trace_buffers = buffer;
+    pthread_mutex_unlock(&trace_lock);
+
+    trace_local = buffer;
+  }
+
+  return trace_local;
+}
+
+static void trace_push(const char *name, uint64_t start_ns, uint64_t end_ns, enum trace_track track) {
+  TraceBuffer *buffer = trace_thread_buffer();
+
+  if (buffer->count == buffer->capacity) {
+    int capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+    TraceEvent *events = realloc(buffer->events, sizeof(TraceEvent) * capacity);
+    if (!events) {
+      fprintf(stderr, "Error: out of memory for trace events\n");
+      exit(1);
+    }
+    buffer->events = events;
+    buffer->capacity = capacity;
+  }
+
+  TraceEvent *event = &buffer->events[buffer->count++];
+  event->name = name;
+  event->start_ns = start_ns;
+  event->end_ns = end_ns;
+  event->track = track;
+}
+
+void trace_thread_name(const char *name) {
+  if (trace_enabled) {
+    trace_thread_buffer()->thread_name = name;
+  }
+}
+
+TraceScope trace_begin(const char *name) {
+  TraceScope scope = { name, 0 };
+
+  if (trace_enabled) {
+    scope.start_ns = trace_now_ns();
+  }
+
+  return scope;
+}
+
+void trace_end(TraceScope *scope) {
+  if (scope->start_ns) {
+    trace_push(scope->name, scope->start_ns, trace_now_ns(), TRACE_TRACK_THREAD);
+  }
+}
+
+void trace_span(const char *name, uint64_t start_ns, uint64_t end_ns, enum trace_track track) {
+  if (trace_enabled) {
+    trace_push(name, start_ns, end_ns, track);
+  }
+}
+
+static void trace_write_string(FILE *file, const char *str) {
+  fputc('"', file);
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\') {
+      fputc('\\', file);
+    }
+    fputc(*str, file);
+  }
+  fputc('"', file);
+}
+
+static void trace_write_thread_name(FILE *file, int tid, const char *name, int *first) {
+  fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+          *first ? "" : ",", tid);
+  trace_write_string(file, name);
+  fprintf(file, "}}");
+  *first = 0;
+}
+
+static void trace_write(void) {
+  FILE *file = fopen(trace_path, "w");
+  if (!file) {
+    fprintf(stderr, "Error: couldn't write trace to %s\n", trace_path);
+    return;
+  }
+
+  /* Threads are all done by now, their buffers are safe to read */
+  int first = 1, count = 0, gpu = 0;
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  for (TraceBuffer *buffer = trace_buffers; buffer; buffer = buffer->next) {
+    char name[32];
+    snprintf(name, sizeof(name), "thread %d", buffer->tid);
+    trace_write_thread_name(file, buffer->tid, buffer->thread_name ? buffer->thread_name : name, &first);
+
+    for (int i = 0; i < buffer->count; i++) {
+      const TraceEvent *event = &buffer->events[i];
+      int tid = event->track == TRACE_TRACK_GPU ? TRACE_GPU_TID : buffer->tid;
+      gpu |= event->track == TRACE_TRACK_GPU;
+
+      fprintf(file, ",\n{\"name\":");
+      trace_write_string(file, event->name);
+      fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+              event->track == TRACE_TRACK_GPU ? "gpu" : "cpu",
+              (double)(int64_t)(event->start_ns - trace_start_ns) / 1e3,
+              (double)(event->end_ns - event->start_ns) / 1e3, tid);
+      count++;
+    }
+  }
+  if (gpu) {
+    trace_write_thread_name(file, TRACE_GPU_TID, "GPU", &first);
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+
+  printf("Trace: %d events written to %s\n", count, trace_path);
+}
+
+void trace_enable(const char *path) {
+  if (trace_enabled) {
+    return;
+  }
+
+  trace_path = path;
+  trace_start_ns = trace_now_ns();
+  trace_enabled = 1;
+  trace_thread_name("main");
+  atexit(trace_write);
+}
@@ -0,0 +1,63 @@
+/* MIT License
+ *
+ * Copyright (c) 2017 Péter Gál
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/* Timeline of named CPU (and optionally GPU) spans, written as Chrome trace
+ * event JSON at exit for chrome://tracing or ui.perfetto.dev. Every thread
+ * records into its own buffer, so tracing takes no locks after a thread's
+ * first event. When tracing is off a scope costs one branch.
+ */
+
+typedef struct {
+  const char *name;   /* must outlive the trace, string literals are fine */
+  uint64_t start_ns;  /* 0 when tracing was off at begin */
+} TraceScope;
+
+enum trace_track {
+  TRACE_TRACK_THREAD,  /* the recording thread's own row */
+  TRACE_TRACK_GPU,     /* shared GPU row, times already in trace_now_ns() terms */
+};
+
+extern int trace_enabled;
+
+/* Starts recording, the JSON goes to path when the process exits */
+void trace_enable(const char *path);
+uint64_t trace_now_ns(void);
+void trace_thread_name(const char *name);
+
+TraceScope trace_begin(const char *name);
+void trace_end(TraceScope *scope);
+void trace_span(const char *name, uint64_t start_ns, uint64_t end_ns, enum trace_track track);
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/* Records a span from here to the end of the enclosing block */
+#define TRACE_SCOPE(name) \
+  TraceScope TRACE_CONCAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_end))) = trace_begin(name)
+
+#endif /* TRACE_H */